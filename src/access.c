@@ -255,8 +255,6 @@ handle_access_dialog (XdpImplAccess *object,
   GtkWidget *area;
   GtkWidget *image;
   GHashTable *choice_table = NULL;
-  GdkDisplay *display;
-  GdkScreen *screen;
   ExternalWindow *external_parent = NULL;
   GtkWidget *fake_parent;
 
@@ -286,17 +284,7 @@ handle_access_dialog (XdpImplAccess *object,
                    arg_parent_window);
     }
 
-  if (external_parent)
-    display = external_window_get_display (external_parent);
-  else
-    display = gdk_display_get_default ();
-  screen = gdk_display_get_default_screen (display);
-
-  fake_parent = g_object_new (GTK_TYPE_WINDOW,
-                              "type", GTK_WINDOW_TOPLEVEL,
-                              "screen", screen,
-                              NULL);
-  g_object_ref_sink (fake_parent);
+  fake_parent = get_fake_parent_for_external_window (external_parent);
 
   dialog = gtk_message_dialog_new (NULL,
                                    0,
@@ -139,6 +139,83 @@ handle_close (XdpImplRequest *object,
   return FALSE;
 }
 
+static char *
+get_user_object_path (void)
+{
+  return g_strdup_printf ("/org/freedesktop/Accounts/User%d", getuid ());
+}
+
+static void
+user_proxy_created (GObject *source_object,
+                    GAsyncResult *result,
+                    gpointer data)
+{
+  g_autoptr(GError) error = NULL;
+  OrgFreedesktopAccountsUser *proxy;
+
+  proxy = org_freedesktop_accounts_user_proxy_new_finish (result, &error);
+  if (proxy == NULL)
+    {
+      g_warning ("Failed to create accounts proxy: %s", error->message);
+      return;
+    }
+
+  if (user == NULL)
+    user = proxy;
+  else
+    g_object_unref (proxy);
+}
+
+static void
+system_bus_acquired (GObject *source_object,
+                     GAsyncResult *result,
+                     gpointer data)
+{
+  g_autoptr(GError) error = NULL;
+  g_autoptr(GDBusConnection) system_bus = NULL;
+  g_autofree char *object_path = NULL;
+
+  system_bus = g_bus_get_finish (result, &error);
+  if (system_bus == NULL)
+    {
+      g_warning ("Failed to connect to the system bus: %s", error->message);
+      return;
+    }
+
+  object_path = get_user_object_path ();
+  org_freedesktop_accounts_user_proxy_new (system_bus,
+                                           G_DBUS_PROXY_FLAGS_DO_NOT_AUTO_START,
+                                           "org.freedesktop.Accounts",
+                                           object_path,
+                                           NULL,
+                                           user_proxy_created,
+                                           NULL);
+}
+
+static OrgFreedesktopAccountsUser *
+get_user (GError **error)
+{
+  g_autoptr(GDBusConnection) system_bus = NULL;
+  g_autofree char *object_path = NULL;
+
+  if (user)
+    return user;
+
+  system_bus = g_bus_get_sync (G_BUS_TYPE_SYSTEM, NULL, error);
+  if (system_bus == NULL)
+    return NULL;
+
+  object_path = get_user_object_path ();
+  user = org_freedesktop_accounts_user_proxy_new_sync (system_bus,
+                                                       G_DBUS_PROXY_FLAGS_DO_NOT_AUTO_START,
+                                                       "org.freedesktop.Accounts",
+                                                       object_path,
+                                                       NULL,
+                                                       error);
+
+  return user;
+}
+
 static gboolean
 handle_get_user_information (XdpImplAccount *object,
                              GDBusMethodInvocation *invocation,
@@ -155,12 +232,16 @@ handle_get_user_information (XdpImplAccount *object,
   const char *real_name;
   const char *icon_file;
   GtkWidget *dialog;
-  GdkDisplay *display;
-  GdkScreen *screen;
   ExternalWindow *external_parent = NULL;
   GtkWidget *fake_parent;
   const char *reason;
 
+  if (get_user (&error) == NULL)
+    {
+      g_dbus_method_invocation_return_gerror (invocation, error);
+      return TRUE;
+    }
+
   sender = g_dbus_method_invocation_get_sender (invocation);
 
   request = request_new (sender, arg_app_id, arg_handle);
@@ -180,17 +261,7 @@ handle_get_user_information (XdpImplAccount *object,
                    arg_parent_window);
     }
 
-  if (external_parent)
-    display = external_window_get_display (external_parent);
-  else
-    display = gdk_display_get_default ();
-  screen = gdk_display_get_default_screen (display);
-
-  fake_parent = g_object_new (GTK_TYPE_WINDOW,
-                              "type", GTK_WINDOW_TOPLEVEL,
-                              "screen", screen,
-                              NULL);
-  g_object_ref_sink (fake_parent);
+  fake_parent = get_fake_parent_for_external_window (external_parent);
 
   dialog = GTK_WIDGET (account_dialog_new (arg_app_id, user_name, real_name, icon_file, reason));
   gtk_window_set_transient_for (GTK_WINDOW (dialog), GTK_WINDOW (fake_parent));
@@ -222,18 +293,11 @@ handle_get_user_information (XdpImplAccount *object,
   return TRUE;
 }
 
-static GDBusConnection *system_bus;
-
 gboolean
 account_init (GDBusConnection *bus,
               GError **error)
 {
   GDBusInterfaceSkeleton *helper;
-  g_autofree char *object_path = NULL;
-
-  system_bus = g_bus_get_sync (G_BUS_TYPE_SYSTEM, NULL, error);
-  if (system_bus == NULL)
-    return FALSE;
 
   helper = G_DBUS_INTERFACE_SKELETON (xdp_impl_account_skeleton_new ());
 
@@ -245,16 +309,8 @@ account_init (GDBusConnection *bus,
                                          error))
     return FALSE;
 
-  object_path = g_strdup_printf ("/org/freedesktop/Accounts/User%d", getuid ());
-
-  user = org_freedesktop_accounts_user_proxy_new_sync (system_bus,
-                                                       G_DBUS_PROXY_FLAGS_DO_NOT_AUTO_START,
-                                                       "org.freedesktop.Accounts",
-                                                       object_path,
-                                                       NULL,
-                                                       error);
-  if (user == NULL)
-    return FALSE;
+  /* A request that comes in before the proxy is ready creates it */
+  g_bus_get (G_BUS_TYPE_SYSTEM, NULL, system_bus_acquired, NULL);
 
   g_debug ("providing %s", g_dbus_interface_skeleton_get_info (helper)->name);
 
@@ -39,6 +39,7 @@
 #include "xdg-desktop-portal-dbus.h"
 
 #include "appchooserdialog.h"
+#include "appindex.h"
 #include "externalwindow.h"
 
 static GHashTable *handles;
@@ -135,7 +136,8 @@ handle_close (XdpImplRequest *object,
   if (handle->request->exported)
     request_unexport (handle->request);
 
-  xdp_impl_request_complete_close (object, invocation);
+  if (invocation)
+    xdp_impl_request_complete_close (object, invocation);
 
   return TRUE;
 }
@@ -157,8 +159,6 @@ handle_choose_application (XdpImplAppChooser *object,
   const char *content_type;
   const char *location;
   gboolean modal;
-  GdkDisplay *display;
-  GdkScreen *screen;
   ExternalWindow *external_parent = NULL;
   GtkWidget *fake_parent;
 
@@ -184,17 +184,7 @@ handle_choose_application (XdpImplAppChooser *object,
                    arg_parent_window);
     }
 
-  if (external_parent)
-    display = external_window_get_display (external_parent);
-  else
-    display = gdk_display_get_default ();
-  screen = gdk_display_get_default_screen (display);
-
-  fake_parent = g_object_new (GTK_TYPE_WINDOW,
-                              "type", GTK_WINDOW_TOPLEVEL,
-                              "screen", screen,
-                              NULL);
-  g_object_ref_sink (fake_parent);
+  fake_parent = get_fake_parent_for_external_window (external_parent);
 
   dialog = GTK_WIDGET (app_chooser_dialog_new (choices, latest_chosen_id, content_type, location));
   gtk_window_set_transient_for (GTK_WINDOW (dialog), GTK_WINDOW (fake_parent));
@@ -276,6 +266,11 @@ app_chooser_init (GDBusConnection *bus,
 
   handles = g_hash_table_new (g_str_hash, g_str_equal);
 
+  /* Map the app index and start checking it for changes */
+  app_index_get ();
+
+  app_chooser_dialog_queue_spare ();
+
   g_debug ("providing %s", g_dbus_interface_skeleton_get_info (helper)->name);
 
   return TRUE;
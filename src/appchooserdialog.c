@@ -30,8 +30,21 @@
 
 #include "appchooserdialog.h"
 #include "appchooserrow.h"
+#include "appindex.h"
+#include "appsearch.h"
+#include "iconcache.h"
 
 #define LOCATION_MAX_LENGTH 40
+#define ICON_SIZE 64
+/* Rows of the full list only hold a position into the app index, so
+ * they are cheap to add; each idle adds this many.
+ */
+#define POPULATE_CHUNK_SIZE 500
+
+enum {
+  FULL_LIST_COLUMN_POSITION,
+  FULL_LIST_N_COLUMNS
+};
 
 struct _AppChooserDialog {
   GtkWindow parent;
@@ -54,7 +67,21 @@ struct _AppChooserDialog {
   char *content_type;
   char *search_text;
 
-  char **choices;
+  /* Maps app ids to their rows in the list */
+  GHashTable *choices;
+
+  /* The full list model only holds positions in full_apps */
+  GtkListStore *full_store;
+  GtkTreeModel *full_filter;
+  GtkTreeModel *full_sort;
+  GVariant *full_apps;
+  GIcon **full_icons;
+  AppSearch *search;
+  guint *scores;
+  GAppInfo *full_list_info;
+  gsize populate_pos;
+  guint populate_id;
+  gulong index_changed_id;
 
   GAppInfo *info;
 };
@@ -74,10 +101,183 @@ static guint signals[LAST_SIGNAL];
 
 G_DEFINE_TYPE (AppChooserDialog, app_chooser_dialog, GTK_TYPE_WINDOW)
 
+/* The icon view also sets up cells to measure every item, so icons
+ * are only loaded from render, for the items that actually get
+ * painted.
+ */
+typedef struct {
+  GtkCellRendererPixbuf parent;
+
+  GIcon *icon;
+} AppIconRenderer;
+
+typedef struct {
+  GtkCellRendererPixbufClass parent_class;
+} AppIconRendererClass;
+
+static GType app_icon_renderer_get_type (void);
+
+G_DEFINE_TYPE (AppIconRenderer, app_icon_renderer, GTK_TYPE_CELL_RENDERER_PIXBUF)
+
+static void
+app_icon_renderer_render (GtkCellRenderer *cell,
+                          cairo_t *cr,
+                          GtkWidget *widget,
+                          const GdkRectangle *background_area,
+                          const GdkRectangle *cell_area,
+                          GtkCellRendererState flags)
+{
+  AppIconRenderer *renderer = (AppIconRenderer *)cell;
+  IconCache *cache = icon_cache_get ();
+  int scale = gtk_widget_get_scale_factor (widget);
+
+  if (renderer->icon &&
+      icon_cache_lookup (cache, renderer->icon, ICON_SIZE, scale) == NULL)
+    icon_cache_load (cache, renderer->icon, ICON_SIZE, scale);
+
+  GTK_CELL_RENDERER_CLASS (app_icon_renderer_parent_class)->render (cell, cr, widget,
+                                                                    background_area,
+                                                                    cell_area,
+                                                                    flags);
+}
+
+static void
+app_icon_renderer_finalize (GObject *object)
+{
+  AppIconRenderer *renderer = (AppIconRenderer *)object;
+
+  g_clear_object (&renderer->icon);
+
+  G_OBJECT_CLASS (app_icon_renderer_parent_class)->finalize (object);
+}
+
+static void
+app_icon_renderer_init (AppIconRenderer *renderer)
+{
+}
+
+static void
+app_icon_renderer_class_init (AppIconRendererClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+  GtkCellRendererClass *cell_class = GTK_CELL_RENDERER_CLASS (klass);
+
+  object_class->finalize = app_icon_renderer_finalize;
+  cell_class->render = app_icon_renderer_render;
+}
+
+static void full_list_icon_func (GtkCellLayout *layout,
+                                 GtkCellRenderer *cell,
+                                 GtkTreeModel *model,
+                                 GtkTreeIter *iter,
+                                 gpointer data);
+static void full_list_name_func (GtkCellLayout *layout,
+                                 GtkCellRenderer *cell,
+                                 GtkTreeModel *model,
+                                 GtkTreeIter *iter,
+                                 gpointer data);
+static void full_list_icon_loaded (IconCache *cache,
+                                   GIcon *icon,
+                                   AppChooserDialog *dialog);
+static void full_list_icons_changed (IconCache *cache,
+                                     AppChooserDialog *dialog);
+static gboolean filter_func (GtkTreeModel *model,
+                             GtkTreeIter *iter,
+                             gpointer data);
+static int compare_func (GtkTreeModel *model,
+                         GtkTreeIter *a,
+                         GtkTreeIter *b,
+                         gpointer data);
+
 static void
 app_chooser_dialog_init (AppChooserDialog *dialog)
 {
+  GtkCellRenderer *renderer;
+
   gtk_widget_init_template (GTK_WIDGET (dialog));
+
+  dialog->choices = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+  /* The full list can contain thousands of apps, so it is an icon view
+   * which only renders the visible items, backed by a model that just
+   * refers to entries in the app index.
+   */
+  dialog->full_store = gtk_list_store_new (FULL_LIST_N_COLUMNS, G_TYPE_UINT);
+  dialog->full_filter = gtk_tree_model_filter_new (GTK_TREE_MODEL (dialog->full_store), NULL);
+  gtk_tree_model_filter_set_visible_func (GTK_TREE_MODEL_FILTER (dialog->full_filter),
+                                          filter_func, dialog, NULL);
+  dialog->full_sort = gtk_tree_model_sort_new_with_model (dialog->full_filter);
+  gtk_tree_sortable_set_default_sort_func (GTK_TREE_SORTABLE (dialog->full_sort),
+                                           compare_func, dialog, NULL);
+  gtk_tree_sortable_set_sort_column_id (GTK_TREE_SORTABLE (dialog->full_sort),
+                                        GTK_TREE_SORTABLE_DEFAULT_SORT_COLUMN_ID,
+                                        GTK_SORT_ASCENDING);
+  gtk_icon_view_set_model (GTK_ICON_VIEW (dialog->full_list), dialog->full_sort);
+
+  /* Icons are loaded asynchronously, and only for items that get
+   * painted, so the icon cell has a fixed size that doesn't depend
+   * on whether the icon is there yet.
+   */
+  renderer = g_object_new (app_icon_renderer_get_type (), NULL);
+  gtk_cell_renderer_set_fixed_size (renderer, ICON_SIZE, ICON_SIZE);
+  gtk_cell_layout_pack_start (GTK_CELL_LAYOUT (dialog->full_list), renderer, FALSE);
+  gtk_cell_layout_set_cell_data_func (GTK_CELL_LAYOUT (dialog->full_list), renderer,
+                                      full_list_icon_func, dialog, NULL);
+
+  renderer = gtk_cell_renderer_text_new ();
+  g_object_set (renderer,
+                "xalign", 0.5,
+                "alignment", PANGO_ALIGN_CENTER,
+                "width-chars", 18,
+                "ellipsize", PANGO_ELLIPSIZE_END,
+                NULL);
+  gtk_cell_layout_pack_start (GTK_CELL_LAYOUT (dialog->full_list), renderer, FALSE);
+  gtk_cell_layout_set_cell_data_func (GTK_CELL_LAYOUT (dialog->full_list), renderer,
+                                      full_list_name_func, dialog, NULL);
+
+  g_signal_connect_object (icon_cache_get (), "icon-loaded",
+                           G_CALLBACK (full_list_icon_loaded), dialog, 0);
+  g_signal_connect_object (icon_cache_get (), "icons-changed",
+                           G_CALLBACK (full_list_icons_changed), dialog, 0);
+}
+
+static void
+app_chooser_dialog_dispose (GObject *object)
+{
+  AppChooserDialog *dialog = APP_CHOOSER_DIALOG (object);
+
+  if (dialog->populate_id)
+    {
+      g_source_remove (dialog->populate_id);
+      dialog->populate_id = 0;
+    }
+
+  if (dialog->index_changed_id)
+    {
+      g_signal_handler_disconnect (app_index_get (), dialog->index_changed_id);
+      dialog->index_changed_id = 0;
+    }
+
+  if (dialog->full_list)
+    gtk_icon_view_set_model (GTK_ICON_VIEW (dialog->full_list), NULL);
+
+  g_clear_object (&dialog->full_sort);
+  g_clear_object (&dialog->full_filter);
+  g_clear_object (&dialog->full_store);
+  g_clear_pointer (&dialog->search, app_search_free);
+  g_clear_pointer (&dialog->scores, g_free);
+  if (dialog->full_icons)
+    {
+      gsize i, n_apps = g_variant_n_children (dialog->full_apps);
+
+      for (i = 0; i < n_apps; i++)
+        g_clear_object (&dialog->full_icons[i]);
+      g_clear_pointer (&dialog->full_icons, g_free);
+    }
+  g_clear_pointer (&dialog->full_apps, g_variant_unref);
+  g_clear_object (&dialog->full_list_info);
+
+  G_OBJECT_CLASS (app_chooser_dialog_parent_class)->dispose (object);
 }
 
 static void
@@ -87,7 +287,7 @@ app_chooser_dialog_finalize (GObject *object)
 
   g_free (dialog->content_type);
   g_free (dialog->search_text);
-  g_strfreev (dialog->choices);
+  g_hash_table_unref (dialog->choices);
 
   G_OBJECT_CLASS (app_chooser_dialog_parent_class)->finalize (object);
 }
@@ -175,23 +375,81 @@ find_in_software (GtkWidget *button,
 }
 
 static void
-populate_full_list (AppChooserDialog *dialog)
+ensure_search (AppChooserDialog *dialog)
 {
-  GList *apps, *l;
+  if (dialog->search)
+    return;
 
-  apps = g_app_info_get_all ();
+  dialog->search = app_search_new (dialog->full_apps);
+  dialog->scores = g_new0 (guint, g_variant_n_children (dialog->full_apps));
+}
 
-  for (l = apps; l; l = l->next)
-    {
-      GAppInfo *info = l->data;
-      GtkWidget *row;
+static gboolean
+populate_full_list_chunk (gpointer data)
+{
+  AppChooserDialog *dialog = data;
+  gsize n_apps;
+  int i;
+
+  n_apps = g_variant_n_children (dialog->full_apps);
+
+  for (i = 0; i < POPULATE_CHUNK_SIZE && dialog->populate_pos < n_apps; i++)
+    gtk_list_store_insert_with_values (dialog->full_store, NULL, -1,
+                                       FULL_LIST_COLUMN_POSITION, (guint) dialog->populate_pos++,
+                                       -1);
+
+  if (dialog->populate_pos < n_apps)
+    return G_SOURCE_CONTINUE;
+
+  dialog->populate_id = 0;
+
+  ensure_search (dialog);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void populate_full_list (AppChooserDialog *dialog);
+static void update_search_results (AppChooserDialog *dialog);
 
-      row = GTK_WIDGET (app_chooser_row_new (info));
-      gtk_widget_set_visible (row, TRUE);
-      gtk_flow_box_insert (GTK_FLOW_BOX (dialog->full_list), row, -1);
+static void
+index_changed (AppIndex *index,
+               AppChooserDialog *dialog)
+{
+  g_signal_handler_disconnect (index, dialog->index_changed_id);
+  dialog->index_changed_id = 0;
+
+  populate_full_list (dialog);
+}
+
+static void
+populate_full_list (AppChooserDialog *dialog)
+{
+  AppIndex *index = app_index_get ();
+  GVariant *apps;
+
+  apps = app_index_get_apps (index);
+  if (apps == NULL)
+    {
+      /* Wait for the index to be built */
+      dialog->index_changed_id = g_signal_connect (index, "changed",
+                                                   G_CALLBACK (index_changed),
+                                                   dialog);
+      return;
     }
 
-  g_list_free_full (apps, g_object_unref);
+  dialog->full_apps = g_variant_ref (apps);
+  dialog->full_icons = g_new0 (GIcon *, g_variant_n_children (apps));
+  dialog->populate_pos = 0;
+
+  if (dialog->search_text)
+    update_search_results (dialog);
+
+  /* Add the rows in chunks, so we don't block on thousands of apps */
+  if (populate_full_list_chunk (dialog) == G_SOURCE_CONTINUE)
+    dialog->populate_id = g_idle_add_full (G_PRIORITY_LOW,
+                                           populate_full_list_chunk,
+                                           dialog,
+                                           NULL);
 }
 
 static gboolean
@@ -243,26 +501,187 @@ more2_clicked (GtkButton *button,
   show_full_list (dialog);
 }
 
+static void
+get_full_list_app (AppChooserDialog *dialog,
+                   GtkTreeModel *model,
+                   GtkTreeIter *iter,
+                   const char **id,
+                   const char **name,
+                   const char **icon)
+{
+  guint pos;
+
+  gtk_tree_model_get (model, iter, FULL_LIST_COLUMN_POSITION, &pos, -1);
+  g_variant_get_child (dialog->full_apps, pos,
+                       APP_INDEX_ENTRY_TYPE_BORROWED,
+                       id, name, NULL, icon, NULL, NULL, NULL);
+}
+
+static void
+full_list_item_activated (GtkIconView *view,
+                          GtkTreePath *path,
+                          AppChooserDialog *dialog)
+{
+  GtkTreeModel *model = gtk_icon_view_get_model (view);
+  GtkTreeIter iter;
+  const char *id;
+
+  if (!gtk_tree_model_get_iter (model, &iter, path))
+    return;
+
+  get_full_list_app (dialog, model, &iter, &id, NULL, NULL);
+
+  g_clear_object (&dialog->full_list_info);
+  dialog->full_list_info = G_APP_INFO (g_desktop_app_info_new (id));
+  if (dialog->full_list_info == NULL)
+    {
+      g_warning ("Application %s is no longer installed", id);
+      return;
+    }
+
+  close_dialog (dialog, dialog->full_list_info);
+}
+
+static void
+full_list_icon_func (GtkCellLayout *layout,
+                     GtkCellRenderer *cell,
+                     GtkTreeModel *model,
+                     GtkTreeIter *iter,
+                     gpointer data)
+{
+  AppChooserDialog *dialog = data;
+  AppIconRenderer *renderer = (AppIconRenderer *)cell;
+  IconCache *cache = icon_cache_get ();
+  int scale = gtk_widget_get_scale_factor (dialog->full_list);
+  GIcon *gicon;
+  cairo_surface_t *surface;
+  guint pos;
+
+  /* Parse icons once per app, cell data is set up for every item
+   * on each layout pass.
+   */
+  gtk_tree_model_get (model, iter, FULL_LIST_COLUMN_POSITION, &pos, -1);
+  gicon = dialog->full_icons[pos];
+  if (gicon == NULL)
+    {
+      const char *icon;
+
+      get_full_list_app (dialog, model, iter, NULL, NULL, &icon);
+
+      if (icon[0] != '\0')
+        gicon = g_icon_new_for_string (icon, NULL);
+      if (gicon == NULL)
+        gicon = g_themed_icon_new ("application-x-executable");
+
+      dialog->full_icons[pos] = gicon;
+    }
+
+  g_set_object (&renderer->icon, gicon);
+
+  surface = icon_cache_lookup (cache, gicon, ICON_SIZE, scale);
+  if (surface == NULL)
+    surface = icon_cache_get_placeholder (cache, ICON_SIZE, scale);
+
+  g_object_set (cell, "surface", surface, NULL);
+}
+
+static void
+full_list_icon_loaded (IconCache *cache,
+                       GIcon *icon,
+                       AppChooserDialog *dialog)
+{
+  if (dialog->full_list && gtk_widget_get_mapped (dialog->full_list))
+    gtk_widget_queue_draw (dialog->full_list);
+}
+
+static void
+full_list_icons_changed (IconCache *cache,
+                         AppChooserDialog *dialog)
+{
+  /* Visible items pick up the new theme's icons when they are redrawn */
+  if (dialog->full_list && gtk_widget_get_mapped (dialog->full_list))
+    gtk_widget_queue_draw (dialog->full_list);
+}
+
+static void
+full_list_name_func (GtkCellLayout *layout,
+                     GtkCellRenderer *cell,
+                     GtkTreeModel *model,
+                     GtkTreeIter *iter,
+                     gpointer data)
+{
+  AppChooserDialog *dialog = data;
+  const char *name;
+
+  get_full_list_app (dialog, model, iter, NULL, &name, NULL);
+
+  g_object_set (cell, "text", name, NULL);
+}
+
+static guint
+get_full_list_position (GtkTreeModel *model,
+                        GtkTreeIter *iter)
+{
+  guint pos;
+
+  gtk_tree_model_get (model, iter, FULL_LIST_COLUMN_POSITION, &pos, -1);
+
+  return pos;
+}
+
 static gboolean
-filter_func (GtkFlowBoxChild *child,
+filter_func (GtkTreeModel *model,
+             GtkTreeIter *iter,
              gpointer data)
 {
-  AppChooserRow *row = APP_CHOOSER_ROW (child);
   AppChooserDialog *dialog = data;
-  GAppInfo *info;
-  char *name;
-  gboolean match;
 
-  if (!dialog->search_text)
+  if (!dialog->search_text || !dialog->scores)
     return TRUE;
 
-  info = app_chooser_row_get_info (row);
+  return dialog->scores[get_full_list_position (model, iter)] > 0;
+}
+
+/* Best matches first, otherwise keep the index order */
+static int
+compare_func (GtkTreeModel *model,
+              GtkTreeIter *a,
+              GtkTreeIter *b,
+              gpointer data)
+{
+  AppChooserDialog *dialog = data;
+  guint pos_a = get_full_list_position (model, a);
+  guint pos_b = get_full_list_position (model, b);
+
+  if (dialog->search_text && dialog->scores &&
+      dialog->scores[pos_a] != dialog->scores[pos_b])
+    return dialog->scores[pos_a] > dialog->scores[pos_b] ? -1 : 1;
+
+  return pos_a < pos_b ? -1 : (pos_a > pos_b ? 1 : 0);
+}
+
+static void
+update_search_results (AppChooserDialog *dialog)
+{
+  gint64 start = g_get_monotonic_time ();
+  guint n_matches = 0;
+
+  if (dialog->search_text && dialog->full_apps)
+    {
+      ensure_search (dialog);
+      n_matches = app_search_query (dialog->search, dialog->search_text, dialog->scores);
+    }
 
-  name = g_utf8_casefold (g_app_info_get_name (info), -1);
-  match = g_str_has_prefix (name, dialog->search_text);
-  g_free (name);
+  gtk_tree_model_filter_refilter (GTK_TREE_MODEL_FILTER (dialog->full_filter));
 
-  return match;
+  /* Setting the sort func again makes the sort model resort */
+  gtk_tree_sortable_set_default_sort_func (GTK_TREE_SORTABLE (dialog->full_sort),
+                                           compare_func, dialog, NULL);
+
+  if (dialog->search_text)
+    g_debug ("Search for '%s': %u matches in %.2f ms",
+             dialog->search_text, n_matches,
+             (g_get_monotonic_time () - start) / 1000.0);
 }
 
 static void
@@ -270,11 +689,16 @@ search_changed (GtkSearchEntry *entry,
                 gpointer data)
 {
   AppChooserDialog *dialog = data;
+  g_autofree char *text = NULL;
 
-  g_free (dialog->search_text);
-  dialog->search_text = g_utf8_casefold (gtk_entry_get_text (GTK_ENTRY (dialog->search_entry)), -1);
+  text = g_utf8_casefold (gtk_entry_get_text (GTK_ENTRY (dialog->search_entry)), -1);
+  g_strstrip (text);
+
+  g_clear_pointer (&dialog->search_text, g_free);
+  if (text[0] != '\0')
+    dialog->search_text = g_steal_pointer (&text);
 
-  gtk_flow_box_invalidate_filter (GTK_FLOW_BOX (dialog->full_list));
+  update_search_results (dialog);
 }
 
 static gboolean
@@ -314,6 +738,7 @@ app_chooser_dialog_class_init (AppChooserDialogClass *class)
   GObjectClass *object_class = G_OBJECT_CLASS (class);
   GtkBindingSet *binding_set;
 
+  object_class->dispose = app_chooser_dialog_dispose;
   object_class->finalize = app_chooser_dialog_finalize;
 
   widget_class->delete_event = app_chooser_delete_event;
@@ -347,6 +772,7 @@ app_chooser_dialog_class_init (AppChooserDialogClass *class)
   gtk_widget_class_bind_template_child (widget_class, AppChooserDialog, separator);
   gtk_widget_class_bind_template_child (widget_class, AppChooserDialog, empty_label);
   gtk_widget_class_bind_template_callback (widget_class, row_activated);
+  gtk_widget_class_bind_template_callback (widget_class, full_list_item_activated);
   gtk_widget_class_bind_template_callback (widget_class, cancel_clicked);
   gtk_widget_class_bind_template_callback (widget_class, link_activated);
   gtk_widget_class_bind_template_callback (widget_class, more_clicked);
@@ -375,18 +801,10 @@ shorten_location (const char *location)
   return g_strconcat ("…", location, NULL);
 }
 
-AppChooserDialog *
-app_chooser_dialog_new (const char **choices,
-                        const char *default_id,
-                        const char *content_type,
-                        const char *location)
+static void
+ensure_css_provider (void)
 {
-  AppChooserDialog *dialog;
-  int n_choices;
-  int i;
   static GtkCssProvider *provider;
-  GtkWidget *default_row;
-  g_autofree char *short_location = shorten_location (location);
 
   if (provider == NULL)
     {
@@ -396,8 +814,58 @@ app_chooser_dialog_new (const char **choices,
                                                  GTK_STYLE_PROVIDER (provider),
                                                  GTK_STYLE_PROVIDER_PRIORITY_APPLICATION);
     }
+}
 
-  dialog = g_object_new (app_chooser_dialog_get_type (), NULL);
+/* Instantiating the templates, loading the CSS and the icon theme
+ * takes long enough to be noticeable, so keep a spare dialog around,
+ * created when idle, that the next request can use right away.
+ */
+static AppChooserDialog *spare_dialog;
+static guint spare_dialog_id;
+
+static gboolean
+create_spare_dialog (gpointer data)
+{
+  spare_dialog_id = 0;
+
+  if (spare_dialog == NULL)
+    {
+      ensure_css_provider ();
+      g_type_ensure (APP_TYPE_CHOOSER_ROW);
+      icon_cache_get_placeholder (icon_cache_get (), ICON_SIZE, 1);
+
+      spare_dialog = g_object_new (app_chooser_dialog_get_type (), NULL);
+      g_debug ("Created spare app chooser dialog");
+    }
+
+  return G_SOURCE_REMOVE;
+}
+
+void
+app_chooser_dialog_queue_spare (void)
+{
+  if (spare_dialog == NULL && spare_dialog_id == 0)
+    spare_dialog_id = g_idle_add_full (G_PRIORITY_LOW, create_spare_dialog, NULL, NULL);
+}
+
+AppChooserDialog *
+app_chooser_dialog_new (const char **choices,
+                        const char *default_id,
+                        const char *content_type,
+                        const char *location)
+{
+  AppChooserDialog *dialog;
+  GtkWidget *default_row;
+  g_autofree char *short_location = shorten_location (location);
+
+  ensure_css_provider ();
+
+  if (spare_dialog)
+    dialog = g_steal_pointer (&spare_dialog);
+  else
+    dialog = g_object_new (app_chooser_dialog_get_type (), NULL);
+
+  app_chooser_dialog_queue_spare ();
 
   dialog->content_type = g_strdup (content_type);
 
@@ -413,88 +881,110 @@ app_chooser_dialog_new (const char **choices,
       gtk_label_set_label (GTK_LABEL (dialog->heading), _("Select an application. More applications are available in <a href='software'>Software.</a>"));
     }
 
-  default_row = NULL;
-
-  dialog->choices = g_strdupv ((char **)choices);
-
-  n_choices = g_strv_length ((char **)choices);
-  if (n_choices == 0)
+  if (location)
     {
-      gtk_stack_set_visible_child_name (GTK_STACK (dialog->stack), "empty");
-      if (location)
-        {
-          g_autofree char *label = NULL;
+      g_autofree char *label = NULL;
 
-          label = g_strdup_printf (_("Unable to find an application that is able to open “%s”."), short_location);
-          gtk_label_set_label (GTK_LABEL (dialog->empty_label), label);
-        }
-      else
-        {
-          gtk_label_set_label (GTK_LABEL (dialog->empty_label), _("Unable to find a suitable application."));
-        }
+      label = g_strdup_printf (_("Unable to find an application that is able to open “%s”."), short_location);
+      gtk_label_set_label (GTK_LABEL (dialog->empty_label), label);
     }
   else
     {
-      gtk_stack_set_visible_child_name (GTK_STACK (dialog->stack), "list");
-      for (i = 0; i < n_choices; i++)
-        {
-          g_autofree char *desktop_id = g_strconcat (choices[i], ".desktop", NULL);
-          g_autoptr(GAppInfo) info = G_APP_INFO (g_desktop_app_info_new (desktop_id));
-          GtkWidget *row;
+      gtk_label_set_label (GTK_LABEL (dialog->empty_label), _("Unable to find a suitable application."));
+    }
+
+  app_chooser_dialog_update_choices (dialog, choices);
 
-          row = GTK_WIDGET (app_chooser_row_new (info));
-          gtk_widget_set_visible (row, TRUE);
-          gtk_flow_box_insert (GTK_FLOW_BOX (dialog->list), row, -1);
+  default_row = default_id ? g_hash_table_lookup (dialog->choices, default_id) : NULL;
+  if (default_row)
+    gtk_widget_grab_focus (default_row);
 
-          if (g_strcmp0 (choices[i], default_id) == 0)
-            default_row = row;
-       }
+  return dialog;
+}
 
-     if (n_choices < 4)
-       gtk_widget_set_halign (dialog->list, GTK_ALIGN_START);
+static GtkWidget *
+create_choice_row (const char *choice)
+{
+  g_autofree char *desktop_id = g_strconcat (choice, ".desktop", NULL);
+  g_autoptr(GAppInfo) info = G_APP_INFO (g_desktop_app_info_new (desktop_id));
+  GtkWidget *row;
 
-     if (default_row)
-       gtk_widget_grab_focus (default_row);
+  if (info == NULL)
+    {
+      g_debug ("Ignoring unknown choice %s", choice);
+      return NULL;
     }
 
-  gtk_flow_box_set_filter_func (GTK_FLOW_BOX (dialog->full_list), filter_func, dialog, NULL);
+  row = GTK_WIDGET (app_chooser_row_new (info));
+  gtk_widget_set_visible (row, TRUE);
 
-  return dialog;
+  return row;
 }
 
+/* Makes the list match choices, in order. Rows that are already
+ * in the list are kept and only moved if their position changed.
+ */
 void
 app_chooser_dialog_update_choices (AppChooserDialog  *dialog,
                                    const char       **choices)
 {
+  g_autoptr(GHashTable) pending = NULL;
+  GHashTableIter iter;
+  gpointer key, value;
+  guint n_choices;
+  int pos;
   int i;
-  GPtrArray *new_choices;
 
-  new_choices = g_ptr_array_new ();
-  g_ptr_array_set_size (new_choices, g_strv_length (dialog->choices));
-  for (i = 0; dialog->choices[i]; i++)
-    new_choices->pdata[i] = dialog->choices[i];
+  pending = g_hash_table_new (g_str_hash, g_str_equal);
+  for (i = 0; choices[i]; i++)
+    g_hash_table_add (pending, (gpointer) choices[i]);
 
+  g_hash_table_iter_init (&iter, dialog->choices);
+  while (g_hash_table_iter_next (&iter, &key, &value))
+    {
+      if (!g_hash_table_contains (pending, key))
+        {
+          gtk_widget_destroy (GTK_WIDGET (value));
+          g_hash_table_iter_remove (&iter);
+        }
+    }
+
+  pos = 0;
   for (i = 0; choices[i]; i++)
     {
-      g_autofree char *desktop_id = NULL;
-      g_autoptr(GAppInfo) info = NULL;
       GtkWidget *row;
 
-      if (g_strv_contains ((const char * const *)dialog->choices, choices[i]))
+      /* Skip duplicates */
+      if (!g_hash_table_remove (pending, choices[i]))
         continue;
 
-      g_ptr_array_add (new_choices, g_strdup (choices[i]));
+      row = g_hash_table_lookup (dialog->choices, choices[i]);
+      if (row == NULL)
+        {
+          row = create_choice_row (choices[i]);
+          if (row == NULL)
+            continue;
 
-      desktop_id = g_strconcat (choices[i], ".desktop", NULL);
-      info = G_APP_INFO (g_desktop_app_info_new (desktop_id));
+          g_hash_table_insert (dialog->choices, g_strdup (choices[i]), row);
+          gtk_flow_box_insert (GTK_FLOW_BOX (dialog->list), row, pos);
+        }
+      else if (gtk_flow_box_child_get_index (GTK_FLOW_BOX_CHILD (row)) != pos)
+        {
+          g_object_ref (row);
+          gtk_container_remove (GTK_CONTAINER (dialog->list), row);
+          gtk_flow_box_insert (GTK_FLOW_BOX (dialog->list), row, pos);
+          g_object_unref (row);
+        }
 
-      row = GTK_WIDGET (app_chooser_row_new (info));
-      gtk_widget_set_visible (row, TRUE);
-      gtk_flow_box_insert (GTK_FLOW_BOX (dialog->list), row, -1);
+      pos++;
     }
 
-  g_ptr_array_add (new_choices, NULL);
+  n_choices = g_hash_table_size (dialog->choices);
+  if (n_choices > 0)
+    gtk_stack_set_visible_child_name (GTK_STACK (dialog->stack), "list");
+  else if (!gtk_widget_get_visible (dialog->full_list_box))
+    gtk_stack_set_visible_child_name (GTK_STACK (dialog->stack), "empty");
 
-  g_free (dialog->choices);
-  dialog->choices = (char **) g_ptr_array_free (new_choices, FALSE);
+  gtk_widget_set_halign (dialog->list,
+                         n_choices < 4 ? GTK_ALIGN_START : GTK_ALIGN_CENTER);
 }
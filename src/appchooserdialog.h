@@ -35,6 +35,8 @@ AppChooserDialog * app_chooser_dialog_new (const char **app_ids,
                                            const char  *content_type,
                                            const char  *filename);
 
+void      app_chooser_dialog_queue_spare (void);
+
 void      app_chooser_dialog_update_choices (AppChooserDialog *dialog,
                                              const char       **app_ids);
 
@@ -20,11 +20,16 @@
 
 #include "config.h"
 #include "appchooserrow.h"
+#include "iconcache.h"
+
+#define ICON_SIZE 64
 
 struct _AppChooserRow {
   GtkFlowBoxChild parent;
 
   GAppInfo *info;
+  GIcon *gicon;
+  gulong icon_loaded_id;
   gboolean selected;
 
   GtkWidget *icon;
@@ -49,6 +54,7 @@ app_chooser_row_finalize (GObject *object)
   AppChooserRow *row = APP_CHOOSER_ROW (object);
 
   g_clear_object (&row->info);
+  g_clear_object (&row->gicon);
 
   G_OBJECT_CLASS (app_chooser_row_parent_class)->finalize (object);
 }
@@ -66,6 +72,43 @@ app_chooser_row_class_init (AppChooserRowClass *class)
   gtk_widget_class_bind_template_child (widget_class, AppChooserRow, name);
 }
 
+static void update_icon (AppChooserRow *row);
+
+static void
+icon_loaded (IconCache *cache,
+             GIcon *icon,
+             AppChooserRow *row)
+{
+  if (g_icon_equal (icon, row->gicon))
+    update_icon (row);
+}
+
+static void
+update_icon (AppChooserRow *row)
+{
+  IconCache *cache = icon_cache_get ();
+  int scale = gtk_widget_get_scale_factor (GTK_WIDGET (row));
+  cairo_surface_t *surface;
+
+  /* Show a placeholder until the icon has been decoded */
+  surface = icon_cache_lookup (cache, row->gicon, ICON_SIZE, scale);
+  if (surface == NULL)
+    {
+      if (row->icon_loaded_id == 0)
+        row->icon_loaded_id = g_signal_connect_object (cache, "icon-loaded",
+                                                       G_CALLBACK (icon_loaded), row, 0);
+      icon_cache_load (cache, row->gicon, ICON_SIZE, scale);
+      surface = icon_cache_get_placeholder (cache, ICON_SIZE, scale);
+    }
+  else if (row->icon_loaded_id != 0)
+    {
+      g_signal_handler_disconnect (cache, row->icon_loaded_id);
+      row->icon_loaded_id = 0;
+    }
+
+  gtk_image_set_from_surface (GTK_IMAGE (row->icon), surface);
+}
+
 AppChooserRow *
 app_chooser_row_new (GAppInfo *info)
 {
@@ -77,11 +120,15 @@ app_chooser_row_new (GAppInfo *info)
   g_set_object (&row->info, info);
 
   icon = g_app_info_get_icon (info);
-  if (!icon)
-    icon = g_themed_icon_new ("application-x-executable");
-
-  gtk_image_set_from_gicon (GTK_IMAGE (row->icon), icon, GTK_ICON_SIZE_DIALOG);
-  gtk_image_set_pixel_size (GTK_IMAGE (row->icon), 64);
+  if (icon)
+    row->gicon = g_object_ref (icon);
+  else
+    row->gicon = g_themed_icon_new ("application-x-executable");
+
+  update_icon (row);
+  g_signal_connect (row, "notify::scale-factor", G_CALLBACK (update_icon), NULL);
+  g_signal_connect_object (icon_cache_get (), "icons-changed",
+                           G_CALLBACK (update_icon), row, G_CONNECT_SWAPPED);
   gtk_label_set_label (GTK_LABEL (row->name), g_app_info_get_name (info));
 
   return row;
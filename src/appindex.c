@@ -0,0 +1,327 @@
+/*
+ * Copyright © 2026 xdg-desktop-portal-gtk contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "config.h"
+
+#include <gio/gdesktopappinfo.h>
+
+#include "appindex.h"
+
+/* The index of installed applications is kept as a serialized GVariant
+ * in the user cache directory, and mapped from there at startup, so the
+ * full app list can be shown without parsing every desktop file. It is
+ * rebuilt in a thread whenever the installed applications change, and
+ * only written out again if the contents differ.
+ */
+
+#define APP_INDEX_FILE "app-index-v2"
+#define REBUILD_TIMEOUT_MILLISECONDS 1000
+
+enum
+{
+  CHANGED,
+
+  N_SIGNALS
+};
+
+static guint signals[N_SIGNALS];
+
+struct _AppIndex
+{
+  GObject parent;
+
+  GVariant *apps;
+
+  GAppInfoMonitor *monitor;
+  guint rebuild_timeout;
+  gboolean rebuilding;
+  gboolean rebuild_pending;
+};
+
+G_DEFINE_TYPE (AppIndex, app_index, G_TYPE_OBJECT)
+
+static AppIndex *_app_index;
+
+static char *
+get_index_path (void)
+{
+  return g_build_filename (g_get_user_cache_dir (),
+                           "xdg-desktop-portal-gtk",
+                           APP_INDEX_FILE,
+                           NULL);
+}
+
+static GVariant *
+load_index (void)
+{
+  g_autofree char *path = get_index_path ();
+  g_autoptr(GMappedFile) mapped = NULL;
+  g_autoptr(GBytes) bytes = NULL;
+
+  mapped = g_mapped_file_new (path, FALSE, NULL);
+  if (mapped == NULL)
+    return NULL;
+
+  bytes = g_mapped_file_get_bytes (mapped);
+
+  return g_variant_ref_sink (g_variant_new_from_bytes (G_VARIANT_TYPE ("a" APP_INDEX_ENTRY_TYPE),
+                                                       bytes,
+                                                       FALSE));
+}
+
+static void
+save_index (GVariant *apps)
+{
+  g_autofree char *path = get_index_path ();
+  g_autofree char *dir = g_path_get_dirname (path);
+  g_autoptr(GError) error = NULL;
+
+  if (g_mkdir_with_parents (dir, 0700) != 0 ||
+      !g_file_set_contents (path,
+                            g_variant_get_data (apps),
+                            g_variant_get_size (apps),
+                            &error))
+    g_warning ("Failed to save app index: %s", error ? error->message : path);
+}
+
+static int
+compare_entries (gconstpointer a,
+                 gconstpointer b)
+{
+  GVariant *entry_a = *(GVariant **)a;
+  GVariant *entry_b = *(GVariant **)b;
+  const char *name_a;
+  const char *name_b;
+
+  g_variant_get_child (entry_a, 2, "&s", &name_a);
+  g_variant_get_child (entry_b, 2, "&s", &name_b);
+
+  return g_utf8_collate (name_a, name_b);
+}
+
+static void
+build_index_thread (GTask *task,
+                    gpointer source_object,
+                    gpointer task_data,
+                    GCancellable *cancellable)
+{
+  g_autoptr(GPtrArray) entries = NULL;
+  GVariantBuilder builder;
+  GVariant *apps;
+  GList *infos, *l;
+  guint i;
+
+  entries = g_ptr_array_new_with_free_func ((GDestroyNotify) g_variant_unref);
+
+  infos = g_app_info_get_all ();
+  for (l = infos; l; l = l->next)
+    {
+      GAppInfo *info = l->data;
+      const char *id = g_app_info_get_id (info);
+      const char *name = g_app_info_get_name (info);
+      const char *no_types[] = { NULL };
+      const char **types;
+      GIcon *icon;
+      g_autofree char *casefolded = NULL;
+      g_autofree char *icon_str = NULL;
+      g_autofree char *flatpak_id = NULL;
+      g_autofree char *terms = NULL;
+
+      if (id == NULL || name == NULL)
+        continue;
+
+      casefolded = g_utf8_casefold (name, -1);
+
+      icon = g_app_info_get_icon (info);
+      if (icon)
+        icon_str = g_icon_to_string (icon);
+
+      types = g_app_info_get_supported_types (info);
+
+      if (G_IS_DESKTOP_APP_INFO (info))
+        {
+          GDesktopAppInfo *desktop_info = G_DESKTOP_APP_INFO (info);
+          const char * const *keywords;
+          const char *generic_name;
+          GString *str;
+          int j;
+
+          flatpak_id = g_desktop_app_info_get_string (desktop_info, "X-Flatpak");
+
+          str = g_string_new ("");
+
+          generic_name = g_desktop_app_info_get_generic_name (desktop_info);
+          if (generic_name)
+            g_string_append (str, generic_name);
+
+          keywords = g_desktop_app_info_get_keywords (desktop_info);
+          for (j = 0; keywords && keywords[j]; j++)
+            {
+              if (str->len > 0)
+                g_string_append_c (str, '\n');
+              g_string_append (str, keywords[j]);
+            }
+
+          terms = g_utf8_casefold (str->str, str->len);
+          g_string_free (str, TRUE);
+        }
+
+      g_ptr_array_add (entries,
+                       g_variant_ref_sink (g_variant_new (APP_INDEX_ENTRY_TYPE,
+                                                          id,
+                                                          name,
+                                                          casefolded,
+                                                          icon_str ? icon_str : "",
+                                                          types ? types : no_types,
+                                                          flatpak_id ? flatpak_id : "",
+                                                          terms ? terms : "")));
+    }
+  g_list_free_full (infos, g_object_unref);
+
+  g_ptr_array_sort (entries, compare_entries);
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a" APP_INDEX_ENTRY_TYPE));
+  for (i = 0; i < entries->len; i++)
+    g_variant_builder_add_value (&builder, g_ptr_array_index (entries, i));
+
+  apps = g_variant_ref_sink (g_variant_builder_end (&builder));
+
+  /* Serialize here rather than on the main thread */
+  g_variant_get_data (apps);
+
+  g_task_return_pointer (task, apps, (GDestroyNotify) g_variant_unref);
+}
+
+static void queue_rebuild (AppIndex *index);
+
+static void
+index_built (GObject *source_object,
+             GAsyncResult *result,
+             gpointer data)
+{
+  AppIndex *index = APP_INDEX (source_object);
+  g_autoptr(GVariant) apps = NULL;
+
+  index->rebuilding = FALSE;
+
+  apps = g_task_propagate_pointer (G_TASK (result), NULL);
+  if (apps && (index->apps == NULL || !g_variant_equal (apps, index->apps)))
+    {
+      g_clear_pointer (&index->apps, g_variant_unref);
+      index->apps = g_steal_pointer (&apps);
+
+      save_index (index->apps);
+
+      g_debug ("App index updated, %" G_GSIZE_FORMAT " apps",
+               g_variant_n_children (index->apps));
+
+      g_signal_emit (index, signals[CHANGED], 0);
+    }
+
+  if (index->rebuild_pending)
+    {
+      index->rebuild_pending = FALSE;
+      queue_rebuild (index);
+    }
+}
+
+static gboolean
+rebuild_timeout (gpointer data)
+{
+  AppIndex *index = data;
+  GTask *task;
+
+  index->rebuild_timeout = 0;
+
+  if (index->rebuilding)
+    {
+      index->rebuild_pending = TRUE;
+      return G_SOURCE_REMOVE;
+    }
+
+  index->rebuilding = TRUE;
+
+  task = g_task_new (index, NULL, index_built, NULL);
+  g_task_run_in_thread (task, build_index_thread);
+  g_object_unref (task);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+queue_rebuild (AppIndex *index)
+{
+  if (index->rebuild_timeout == 0)
+    index->rebuild_timeout = g_timeout_add (REBUILD_TIMEOUT_MILLISECONDS,
+                                            rebuild_timeout,
+                                            index);
+}
+
+static void
+apps_changed (GAppInfoMonitor *monitor,
+              AppIndex *index)
+{
+  queue_rebuild (index);
+}
+
+/* Returns the installed applications as an array of
+ * APP_INDEX_ENTRY_TYPE, or NULL if the index has not
+ * been built yet.
+ */
+GVariant *
+app_index_get_apps (AppIndex *index)
+{
+  return index->apps;
+}
+
+AppIndex *
+app_index_get (void)
+{
+  AppIndex *index;
+
+  if (_app_index)
+    return _app_index;
+
+  index = g_object_new (app_index_get_type (), NULL);
+  index->apps = load_index ();
+
+  index->monitor = g_app_info_monitor_get ();
+  g_signal_connect (index->monitor, "changed", G_CALLBACK (apps_changed), index);
+
+  /* The mapped index may be stale, check it once we are idle */
+  queue_rebuild (index);
+
+  _app_index = index;
+  return index;
+}
+
+static void
+app_index_init (AppIndex *index)
+{
+}
+
+static void
+app_index_class_init (AppIndexClass *klass)
+{
+  signals[CHANGED] = g_signal_new ("changed",
+                                   G_TYPE_FROM_CLASS (klass),
+                                   G_SIGNAL_RUN_LAST,
+                                   0,
+                                   NULL, NULL, NULL,
+                                   G_TYPE_NONE, 0);
+}
@@ -0,0 +1,36 @@
+/*
+ * Copyright © 2026 xdg-desktop-portal-gtk contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+
+/* Each entry is (id, name, casefolded name, icon, mime types, flatpak id,
+ * search terms), sorted by name. The icon is serialized with
+ * g_icon_to_string(), the search terms are the casefolded generic name
+ * and keywords, separated by newlines. Empty strings are used for
+ * missing values.
+ */
+#define APP_INDEX_ENTRY_TYPE "(ssssasss)"
+#define APP_INDEX_ENTRY_TYPE_BORROWED "(&s&s&s&s@as&s&s)"
+
+G_DECLARE_FINAL_TYPE (AppIndex, app_index, APP, INDEX, GObject)
+
+AppIndex * app_index_get (void);
+
+GVariant * app_index_get_apps (AppIndex *index);
@@ -0,0 +1,260 @@
+/*
+ * Copyright © 2026 xdg-desktop-portal-gtk contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include "appindex.h"
+#include "appsearch.h"
+
+/* A trigram index over the casefolded names and search terms of the
+ * apps in the app index. Queries of three or more bytes are matched by
+ * how many of their trigrams an app contains, which tolerates a typo
+ * in longer queries; shorter queries only match at word starts. Exact
+ * prefix and substring matches are ranked above fuzzy ones.
+ */
+
+#define TRIGRAM(s) (((guint32)(guchar)(s)[0] << 16) | \
+                    ((guint32)(guchar)(s)[1] << 8) | \
+                    ((guint32)(guchar)(s)[2]))
+
+/* One typo changes at most three trigrams of the query */
+#define MAX_TYPOS 1
+
+#define SCORE_NAME_PREFIX  300
+#define SCORE_NAME_WORD    200
+#define SCORE_NAME_SUBSTR  100
+#define SCORE_TERMS_WORD    50
+#define SCORE_TERMS_SUBSTR  25
+
+struct _AppSearch
+{
+  guint n_apps;
+  GStringChunk *strings;
+  const char **names;
+  const char **terms;
+
+  GHashTable *trigrams;
+  guint *counts;
+};
+
+static void
+add_trigrams (AppSearch  *search,
+              const char *text,
+              guint       pos)
+{
+  gsize len = strlen (text);
+  gsize i;
+
+  for (i = 0; i + 3 <= len; i++)
+    {
+      guint32 trigram = TRIGRAM (text + i);
+      GArray *postings;
+
+      if (memchr (text + i, '\n', 3) != NULL)
+        continue;
+
+      postings = g_hash_table_lookup (search->trigrams, GUINT_TO_POINTER (trigram));
+      if (postings == NULL)
+        {
+          postings = g_array_new (FALSE, FALSE, sizeof (guint));
+          g_hash_table_insert (search->trigrams, GUINT_TO_POINTER (trigram), postings);
+        }
+
+      /* Apps are added in order, so duplicates are always at the end */
+      if (postings->len > 0 &&
+          g_array_index (postings, guint, postings->len - 1) == pos)
+        continue;
+
+      g_array_append_val (postings, pos);
+    }
+}
+
+AppSearch *
+app_search_new (GVariant *apps)
+{
+  AppSearch *search;
+  guint i;
+
+  search = g_new0 (AppSearch, 1);
+  search->n_apps = g_variant_n_children (apps);
+  search->strings = g_string_chunk_new (4096);
+  search->names = g_new (const char *, search->n_apps);
+  search->terms = g_new (const char *, search->n_apps);
+  search->counts = g_new0 (guint, search->n_apps);
+  search->trigrams = g_hash_table_new_full (NULL, NULL, NULL,
+                                            (GDestroyNotify) g_array_unref);
+
+  for (i = 0; i < search->n_apps; i++)
+    {
+      const char *name;
+      const char *terms;
+
+      g_variant_get_child (apps, i, APP_INDEX_ENTRY_TYPE_BORROWED,
+                           NULL, NULL, &name, NULL, NULL, NULL, &terms);
+
+      search->names[i] = g_string_chunk_insert_const (search->strings, name);
+      search->terms[i] = g_string_chunk_insert_const (search->strings, terms);
+
+      add_trigrams (search, search->names[i], i);
+      add_trigrams (search, search->terms[i], i);
+    }
+
+  return search;
+}
+
+void
+app_search_free (AppSearch *search)
+{
+  g_hash_table_unref (search->trigrams);
+  g_string_chunk_free (search->strings);
+  g_free (search->names);
+  g_free (search->terms);
+  g_free (search->counts);
+
+  g_free (search);
+}
+
+static gboolean
+is_word_start (const char *text,
+               const char *p)
+{
+  return p == text || !g_unichar_isalnum (g_utf8_get_char (g_utf8_prev_char (p)));
+}
+
+static gboolean
+find_word_start (const char *text,
+                 const char *query)
+{
+  const char *p = text;
+
+  while ((p = strstr (p, query)) != NULL)
+    {
+      if (is_word_start (text, p))
+        return TRUE;
+      p++;
+    }
+
+  return FALSE;
+}
+
+static guint
+score_substring (AppSearch  *search,
+                 guint       pos,
+                 const char *query,
+                 gboolean    word_start_only)
+{
+  const char *name = search->names[pos];
+  const char *terms = search->terms[pos];
+
+  if (g_str_has_prefix (name, query))
+    return SCORE_NAME_PREFIX;
+
+  if (find_word_start (name, query))
+    return SCORE_NAME_WORD;
+
+  if (!word_start_only && strstr (name, query) != NULL)
+    return SCORE_NAME_SUBSTR;
+
+  if (find_word_start (terms, query))
+    return SCORE_TERMS_WORD;
+
+  if (!word_start_only && strstr (terms, query) != NULL)
+    return SCORE_TERMS_SUBSTR;
+
+  return 0;
+}
+
+/* Fills scores, which must have room for one entry per app, with
+ * the rank of each app for the casefolded query; 0 means no match.
+ * Returns the number of matching apps.
+ */
+guint
+app_search_query (AppSearch  *search,
+                  const char *query,
+                  guint      *scores)
+{
+  g_autoptr(GHashTable) seen = NULL;
+  gsize len = strlen (query);
+  guint n_trigrams = 0;
+  guint n_matches = 0;
+  guint threshold;
+  gsize i;
+  guint j;
+
+  if (len < 3)
+    {
+      for (j = 0; j < search->n_apps; j++)
+        {
+          scores[j] = score_substring (search, j, query, TRUE);
+          if (scores[j] > 0)
+            n_matches++;
+        }
+
+      return n_matches;
+    }
+
+  seen = g_hash_table_new (NULL, NULL);
+
+  for (i = 0; i + 3 <= len; i++)
+    {
+      guint32 trigram = TRIGRAM (query + i);
+      GArray *postings;
+
+      if (!g_hash_table_add (seen, GUINT_TO_POINTER (trigram)))
+        continue;
+
+      n_trigrams++;
+
+      postings = g_hash_table_lookup (search->trigrams, GUINT_TO_POINTER (trigram));
+      if (postings == NULL)
+        continue;
+
+      for (j = 0; j < postings->len; j++)
+        search->counts[g_array_index (postings, guint, j)]++;
+    }
+
+  /* Short queries only have one or two trigrams, and matching just
+   * one of them matches far too much. Longer ones may miss the three
+   * trigrams a typo touches, but must still share at least half of
+   * their trigrams with the app.
+   */
+  if (len < 5)
+    threshold = n_trigrams;
+  else if (n_trigrams > 3 * MAX_TYPOS)
+    threshold = MAX (n_trigrams - 3 * MAX_TYPOS, (n_trigrams + 1) / 2);
+  else
+    threshold = (n_trigrams + 1) / 2;
+
+  for (j = 0; j < search->n_apps; j++)
+    {
+      guint count = search->counts[j];
+
+      search->counts[j] = 0;
+      scores[j] = 0;
+
+      if (count < threshold)
+        continue;
+
+      scores[j] = count * 100 / n_trigrams + score_substring (search, j, query, FALSE);
+      n_matches++;
+    }
+
+  return n_matches;
+}
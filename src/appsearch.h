@@ -0,0 +1,32 @@
+/*
+ * Copyright © 2026 xdg-desktop-portal-gtk contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include <glib.h>
+
+typedef struct _AppSearch AppSearch;
+
+AppSearch *app_search_new   (GVariant   *apps);
+void       app_search_free  (AppSearch  *search);
+
+guint      app_search_query (AppSearch  *search,
+                             const char *query,
+                             guint      *scores);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (AppSearch, app_search_free)
@@ -20,12 +20,49 @@
 #include "background.h"
 #include "fdonotification.h"
 #include "request.h"
+#include "trace.h"
 #include "utils.h"
 
 static OrgGnomeShellIntrospect *shell;
 
 typedef enum { BACKGROUND, RUNNING, ACTIVE } AppState;
 
+static void
+shell_proxy_created (GObject *source_object,
+                     GAsyncResult *result,
+                     gpointer data)
+{
+  g_autoptr(GError) error = NULL;
+  OrgGnomeShellIntrospect *proxy;
+
+  proxy = org_gnome_shell_introspect_proxy_new_finish (result, &error);
+  if (proxy == NULL)
+    {
+      g_warning ("Failed to create introspect proxy: %s", error->message);
+      return;
+    }
+
+  if (shell == NULL)
+    shell = proxy;
+  else
+    g_object_unref (proxy);
+}
+
+static OrgGnomeShellIntrospect *
+get_shell (GDBusConnection *bus,
+           GError **error)
+{
+  if (shell == NULL)
+    shell = org_gnome_shell_introspect_proxy_new_sync (bus,
+                                                       G_DBUS_PROXY_FLAGS_DO_NOT_AUTO_START,
+                                                       "org.gnome.Shell",
+                                                       "/org/gnome/Shell/Introspect",
+                                                       NULL,
+                                                       error);
+
+  return shell;
+}
+
 static char *
 get_actual_app_id (const char *app_id)
 {
@@ -51,10 +88,17 @@ handle_get_app_state (XdpImplBackground *object,
   GHashTableIter iter;
   const char *key;
   gpointer value;
+  gint64 start_time;
+  gboolean ret;
 
   g_debug ("background: handle GetAppState");
 
-  if (!org_gnome_shell_introspect_call_get_windows_sync (shell, &windows, NULL, &error))
+  start_time = TRACE_CURRENT_TIME;
+  ret = get_shell (g_dbus_method_invocation_get_connection (invocation), &error) != NULL &&
+        org_gnome_shell_introspect_call_get_windows_sync (shell, &windows, NULL, &error);
+  trace_mark (start_time, TRACE_CURRENT_TIME - start_time, "dbus-call", "GetWindows");
+
+  if (!ret)
     {
       g_dbus_method_invocation_return_error (invocation,
                                              XDG_DESKTOP_PORTAL_ERROR,
@@ -223,7 +267,8 @@ handle_close (XdpImplRequest *object,
 
   background_handle_close (handle);
 
-  xdp_impl_request_complete_close (object, invocation);
+  if (invocation)
+    xdp_impl_request_complete_close (object, invocation);
 
   return TRUE;
 }
@@ -429,12 +474,14 @@ background_init (GDBusConnection *bus,
 {
   GDBusInterfaceSkeleton *helper;
 
-  shell = org_gnome_shell_introspect_proxy_new_sync (bus,
-                                                     G_DBUS_PROXY_FLAGS_DO_NOT_AUTO_START,
-                                                     "org.gnome.Shell",
-                                                     "/org/gnome/Shell/Introspect",
-                                                     NULL,
-                                                     NULL);
+  /* A request that comes in before the proxy is ready creates it */
+  org_gnome_shell_introspect_proxy_new (bus,
+                                        G_DBUS_PROXY_FLAGS_DO_NOT_AUTO_START,
+                                        "org.gnome.Shell",
+                                        "/org/gnome/Shell/Introspect",
+                                        NULL,
+                                        shell_proxy_created,
+                                        NULL);
 
   helper = G_DBUS_INTERFACE_SKELETON (xdp_impl_background_skeleton_new ());
 
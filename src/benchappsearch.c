@@ -0,0 +1,160 @@
+#include <string.h>
+
+#include <gio/gio.h>
+
+#include "appindex.h"
+#include "appsearch.h"
+
+/* Builds a synthetic app index and times searching it, to check that
+ * typing in the app chooser stays fast with thousands of apps. It
+ * also checks that queries with a typo still find the app.
+ */
+
+static const char *syllables[] = {
+  "fire", "fox", "text", "edit", "term", "nal", "photo", "shop",
+  "mail", "office", "calc", "writer", "player", "video", "music",
+  "code", "studio", "chat", "web", "view", "image", "draw", "note",
+  "book", "map", "game", "sync", "cloud", "disk", "file", "man",
+  "ager", "pad", "lab", "kit", "board", "star", "dev", "tool", "box",
+};
+
+static const char *queries[] = {
+  "f", "fi", "fir", "fire", "firef", "firefox", "text edit",
+  "terminal", "phtoshop", "musc player", "zzz",
+};
+
+static const struct {
+  const char *name;
+  const char *query;
+} typos[] = {
+  { "Photoshop", "phtoshop" },
+  { "Music Player", "musc player" },
+};
+
+static char *
+make_name (GRand *rand)
+{
+  GString *name = g_string_new (NULL);
+  int n_syllables = g_rand_int_range (rand, 2, 5);
+  int i;
+
+  for (i = 0; i < n_syllables; i++)
+    {
+      const char *syllable = syllables[g_rand_int_range (rand, 0, G_N_ELEMENTS (syllables))];
+
+      if (i > 0 && g_rand_boolean (rand))
+        g_string_append_c (name, ' ');
+      g_string_append (name, syllable);
+    }
+
+  name->str[0] = g_ascii_toupper (name->str[0]);
+
+  return g_string_free (name, FALSE);
+}
+
+static GVariant *
+make_apps (int n_apps)
+{
+  g_autoptr(GRand) rand = g_rand_new_with_seed (42);
+  const char *no_types[] = { NULL };
+  GVariantBuilder builder;
+  int i;
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a" APP_INDEX_ENTRY_TYPE));
+  for (i = 0; i < n_apps; i++)
+    {
+      g_autofree char *name = make_name (rand);
+      g_autofree char *casefolded = g_utf8_casefold (name, -1);
+      g_autofree char *id = g_strdup_printf ("org.example.App%d.desktop", i);
+      g_autofree char *generic = make_name (rand);
+      g_autofree char *terms = g_utf8_casefold (generic, -1);
+
+      g_variant_builder_add (&builder, APP_INDEX_ENTRY_TYPE,
+                             id, name, casefolded,
+                             "application-x-executable",
+                             no_types, "", terms);
+    }
+
+  for (i = 0; i < (int) G_N_ELEMENTS (typos); i++)
+    {
+      g_autofree char *casefolded = g_utf8_casefold (typos[i].name, -1);
+      g_autofree char *id = g_strdup_printf ("org.example.Typo%d.desktop", i);
+
+      g_variant_builder_add (&builder, APP_INDEX_ENTRY_TYPE,
+                             id, typos[i].name, casefolded,
+                             "application-x-executable",
+                             no_types, "", "");
+    }
+
+  return g_variant_ref_sink (g_variant_builder_end (&builder));
+}
+
+int
+main (int argc, char *argv[])
+{
+  g_autoptr(GVariant) apps = NULL;
+  g_autoptr(AppSearch) search = NULL;
+  g_autofree guint *scores = NULL;
+  int n_apps = 5000;
+  int n_iterations = 100;
+  GOptionEntry entries[] = {
+    { "apps", 0, 0, G_OPTION_ARG_INT, &n_apps, "Number of apps", "N" },
+    { "iterations", 0, 0, G_OPTION_ARG_INT, &n_iterations, "Queries per search string", "N" },
+    { NULL, }
+  };
+  g_autoptr(GOptionContext) context = NULL;
+  g_autoptr(GError) error = NULL;
+  gint64 start;
+  gsize i;
+  int j;
+
+  context = g_option_context_new (NULL);
+  g_option_context_add_main_entries (context, entries, NULL);
+  if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+      g_printerr ("%s\n", error->message);
+      return 1;
+    }
+
+  if (n_apps <= 0 || n_iterations <= 0)
+    {
+      g_printerr ("Need at least one app and one iteration\n");
+      return 1;
+    }
+
+  apps = make_apps (n_apps);
+
+  start = g_get_monotonic_time ();
+  search = app_search_new (apps);
+  g_print ("%d apps, index built in %.2f ms\n",
+           n_apps, (g_get_monotonic_time () - start) / 1000.0);
+
+  scores = g_new0 (guint, n_apps + G_N_ELEMENTS (typos));
+
+  /* The typo apps come right after the synthetic ones */
+  for (i = 0; i < G_N_ELEMENTS (typos); i++)
+    {
+      app_search_query (search, typos[i].query, scores);
+      if (scores[n_apps + i] == 0)
+        {
+          g_printerr ("\"%s\" does not match %s\n",
+                      typos[i].query, typos[i].name);
+          return 1;
+        }
+    }
+
+  for (i = 0; i < G_N_ELEMENTS (queries); i++)
+    {
+      guint n_matches = 0;
+
+      start = g_get_monotonic_time ();
+      for (j = 0; j < n_iterations; j++)
+        n_matches = app_search_query (search, queries[i], scores);
+
+      g_print ("%-12s %5u matches, %8.3f ms per query\n",
+               queries[i], n_matches,
+               (g_get_monotonic_time () - start) / 1000.0 / n_iterations);
+    }
+
+  return 0;
+}
@@ -41,7 +41,7 @@ typedef struct _Monitor
 typedef struct _LogicalMonitor
 {
   gboolean is_primary;
-  GList *monitors;
+  GPtrArray *monitors;
 } LogicalMonitor;
 
 struct _DisplayStateTracker
@@ -54,13 +54,18 @@ struct _DisplayStateTracker
   OrgGnomeMutterDisplayConfig *proxy;
 
   GHashTable *monitors;
-  GList *logical_monitors;
+  GPtrArray *logical_monitors;
+
+  gboolean fetching_state;
+  gboolean state_outdated;
 };
 
 G_DEFINE_TYPE (DisplayStateTracker, display_state_tracker, G_TYPE_OBJECT)
 
 static DisplayStateTracker *_display_state_tracker;
 
+static void sync_state (DisplayStateTracker *tracker);
+
 static void
 monitor_free (Monitor *monitor)
 {
@@ -69,6 +74,13 @@ monitor_free (Monitor *monitor)
   g_free (monitor);
 }
 
+static void
+logical_monitor_free (LogicalMonitor *logical_monitor)
+{
+  g_ptr_array_unref (logical_monitor->monitors);
+  g_free (logical_monitor);
+}
+
 const char *
 monitor_get_connector (Monitor *monitor)
 {
@@ -81,7 +93,7 @@ monitor_get_display_name (Monitor *monitor)
   return monitor->display_name;
 }
 
-GList *
+GPtrArray *
 logical_monitor_get_monitors (LogicalMonitor *logical_monitor)
 {
   return logical_monitor->monitors;
@@ -93,26 +105,37 @@ logical_monitor_is_primary (LogicalMonitor *logical_monitor)
   return logical_monitor->is_primary;
 }
 
-GList *
+GPtrArray *
 display_state_tracker_get_logical_monitors (DisplayStateTracker *tracker)
 {
   return tracker->logical_monitors;
 }
 
+/* Updates the monitors in place, so that the Monitor structs stay
+ * valid for as long as the connector is there. Monitors that are
+ * gone are moved to @removed, and those that got renamed are added
+ * to @renamed.
+ */
 static void
-generate_monitors (DisplayStateTracker *tracker,
-                   GVariant *monitors)
+update_monitors (DisplayStateTracker *tracker,
+                 GVariant *monitors,
+                 GPtrArray *removed,
+                 GHashTable *renamed)
 {
+  g_autoptr(GHashTable) seen = NULL;
   GVariantIter monitors_iter;
   GVariant *monitor_variant;
+  GHashTableIter iter;
+  Monitor *monitor;
+
+  seen = g_hash_table_new (NULL, NULL);
 
   g_variant_iter_init (&monitors_iter, monitors);
   while ((monitor_variant = g_variant_iter_next_value (&monitors_iter)))
     {
-      Monitor *monitor;
-      char *connector;
+      g_autofree char *connector = NULL;
+      g_autoptr(GVariant) properties = NULL;
       char *display_name;
-      GVariant *properties;
 
       g_variant_get (monitor_variant, "((ssss)a(siiddada{sv})@a{sv})",
                      &connector,
@@ -125,32 +148,105 @@ generate_monitors (DisplayStateTracker *tracker,
       if (!g_variant_lookup (properties, "display-name", "s", &display_name))
         display_name = g_strdup (connector);
 
-      monitor = g_new0 (Monitor, 1);
-      *monitor = (Monitor) {
-        .connector = connector,
-        .display_name = display_name
-      };
+      monitor = g_hash_table_lookup (tracker->monitors, connector);
+      if (monitor == NULL)
+        {
+          monitor = g_new0 (Monitor, 1);
+          *monitor = (Monitor) {
+            .connector = g_steal_pointer (&connector),
+            .display_name = display_name
+          };
+
+          g_hash_table_insert (tracker->monitors, monitor->connector, monitor);
+        }
+      else if (g_strcmp0 (monitor->display_name, display_name) != 0)
+        {
+          g_free (monitor->display_name);
+          monitor->display_name = display_name;
+          g_hash_table_add (renamed, monitor);
+        }
+      else
+        {
+          g_free (display_name);
+        }
 
-      g_hash_table_insert (tracker->monitors, connector, monitor);
+      g_hash_table_add (seen, monitor);
 
       g_variant_unref (monitor_variant);
     }
+
+  g_hash_table_iter_init (&iter, tracker->monitors);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *)&monitor))
+    {
+      if (g_hash_table_contains (seen, monitor))
+        continue;
+
+      g_hash_table_iter_steal (&iter);
+      g_ptr_array_add (removed, monitor);
+    }
+}
+
+static gboolean
+logical_monitor_equal (LogicalMonitor *logical_monitor,
+                       gboolean is_primary,
+                       GPtrArray *monitors)
+{
+  guint i;
+
+  if (logical_monitor->is_primary != is_primary ||
+      logical_monitor->monitors->len != monitors->len)
+    return FALSE;
+
+  for (i = 0; i < monitors->len; i++)
+    {
+      if (logical_monitor->monitors->pdata[i] != monitors->pdata[i])
+        return FALSE;
+    }
+
+  return TRUE;
 }
 
+/* Logical monitors are matched to the previous state by their first
+ * monitor. Matching ones are updated in place and reported as changed
+ * only if they differ.
+ */
 static void
-generate_logical_monitors (DisplayStateTracker *tracker,
-                           GVariant *logical_monitors)
+update_logical_monitors (DisplayStateTracker *tracker,
+                         GVariant *logical_monitors,
+                         GHashTable *renamed,
+                         GPtrArray *added,
+                         GPtrArray *changed,
+                         GPtrArray *removed)
 {
+  g_autoptr(GHashTable) old_logical_monitors = NULL;
+  GPtrArray *new_logical_monitors;
   GVariantIter logical_monitors_iter;
   GVariant *logical_monitor_variant;
+  GHashTableIter iter;
+  LogicalMonitor *logical_monitor;
+  guint i;
+
+  old_logical_monitors = g_hash_table_new (NULL, NULL);
+  for (i = 0; i < tracker->logical_monitors->len; i++)
+    {
+      logical_monitor = tracker->logical_monitors->pdata[i];
+      g_hash_table_insert (old_logical_monitors,
+                           logical_monitor->monitors->pdata[0],
+                           logical_monitor);
+    }
+
+  new_logical_monitors =
+    g_ptr_array_new_full (g_variant_n_children (logical_monitors),
+                          (GDestroyNotify) logical_monitor_free);
 
   g_variant_iter_init (&logical_monitors_iter, logical_monitors);
   while ((logical_monitor_variant = g_variant_iter_next_value (&logical_monitors_iter)))
     {
-      LogicalMonitor *logical_monitor;
       gboolean is_primary;
-      g_autoptr(GVariantIter) monitors_iter;
+      g_autoptr(GVariantIter) monitors_iter = NULL;
+      g_autoptr(GPtrArray) monitors = NULL;
       GVariant *monitor_variant;
+      gboolean is_renamed = FALSE;
 
       g_variant_get (logical_monitor_variant, "(iiduba(ssss)a{sv})",
                      NULL /* x */,
@@ -161,10 +257,7 @@ generate_logical_monitors (DisplayStateTracker *tracker,
                      &monitors_iter,
                      NULL /* properties */);
 
-      logical_monitor = g_new0 (LogicalMonitor, 1);
-      *logical_monitor = (LogicalMonitor) {
-        .is_primary = is_primary
-      };
+      monitors = g_ptr_array_sized_new (g_variant_iter_n_children (monitors_iter));
 
       while ((monitor_variant = g_variant_iter_next_value (monitors_iter)))
         {
@@ -178,17 +271,61 @@ generate_logical_monitors (DisplayStateTracker *tracker,
                          NULL /* serial */);
 
           monitor = g_hash_table_lookup (tracker->monitors, connector);
-
-          logical_monitor->monitors = g_list_append (logical_monitor->monitors, monitor);
+          if (monitor)
+            {
+              g_ptr_array_add (monitors, monitor);
+              is_renamed |= g_hash_table_contains (renamed, monitor);
+            }
 
           g_variant_unref (monitor_variant);
         }
 
-      tracker->logical_monitors = g_list_append (tracker->logical_monitors,
-                                                 logical_monitor);
-
       g_variant_unref (logical_monitor_variant);
+
+      if (monitors->len == 0)
+        continue;
+
+      logical_monitor = g_hash_table_lookup (old_logical_monitors,
+                                             monitors->pdata[0]);
+      if (logical_monitor)
+        {
+          g_hash_table_remove (old_logical_monitors, monitors->pdata[0]);
+
+          if (!logical_monitor_equal (logical_monitor, is_primary, monitors))
+            {
+              logical_monitor->is_primary = is_primary;
+              g_ptr_array_unref (logical_monitor->monitors);
+              logical_monitor->monitors = g_steal_pointer (&monitors);
+              g_ptr_array_add (changed, logical_monitor);
+            }
+          else if (is_renamed)
+            {
+              g_ptr_array_add (changed, logical_monitor);
+            }
+        }
+      else
+        {
+          logical_monitor = g_new0 (LogicalMonitor, 1);
+          *logical_monitor = (LogicalMonitor) {
+            .is_primary = is_primary,
+            .monitors = g_steal_pointer (&monitors)
+          };
+          g_ptr_array_add (added, logical_monitor);
+        }
+
+      g_ptr_array_add (new_logical_monitors, logical_monitor);
     }
+
+  /* Whatever is left did not match anything, hand it over to @removed
+   * to be freed after listeners have been told.
+   */
+  g_hash_table_iter_init (&iter, old_logical_monitors);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *)&logical_monitor))
+    g_ptr_array_add (removed, logical_monitor);
+
+  g_ptr_array_set_free_func (tracker->logical_monitors, NULL);
+  g_ptr_array_unref (tracker->logical_monitors);
+  tracker->logical_monitors = new_logical_monitors;
 }
 
 static void
@@ -200,8 +337,15 @@ get_current_state_cb (GObject *source_object,
   g_autoptr(GVariant) monitors = NULL;
   g_autoptr(GVariant) logical_monitors = NULL;
   g_autoptr(GError) error = NULL;
+  g_autoptr(GHashTable) renamed = NULL;
+  g_autoptr(GPtrArray) removed_monitors = NULL;
+  g_autoptr(GPtrArray) added = NULL;
+  g_autoptr(GPtrArray) changed = NULL;
+  g_autoptr(GPtrArray) removed = NULL;
+
+  tracker->fetching_state = FALSE;
 
-  if (!org_gnome_mutter_display_config_call_get_current_state_finish (tracker->proxy,
+  if (!org_gnome_mutter_display_config_call_get_current_state_finish (ORG_GNOME_MUTTER_DISPLAY_CONFIG (source_object),
                                                                       NULL,
                                                                       &monitors,
                                                                       &logical_monitors,
@@ -209,22 +353,50 @@ get_current_state_cb (GObject *source_object,
                                                                       res,
                                                                       &error))
     {
+      /* DisplayConfig went away, it is fetched again when it is back */
+      if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        return;
+
       g_warning ("Failed to get current display state: %s", error->message);
+
+      /* Changes that came in meanwhile may well have caused the
+       * failure, and nothing else will trigger a refetch for them.
+       */
+      if (tracker->state_outdated)
+        sync_state (tracker);
       return;
     }
 
-  g_list_free_full (tracker->logical_monitors, g_free);
-  tracker->logical_monitors = NULL;
-  g_hash_table_remove_all (tracker->monitors);
-  generate_monitors (tracker, monitors);
-  generate_logical_monitors (tracker, logical_monitors);
+  renamed = g_hash_table_new (NULL, NULL);
+  removed_monitors = g_ptr_array_new_with_free_func ((GDestroyNotify) monitor_free);
+  added = g_ptr_array_new ();
+  changed = g_ptr_array_new ();
+  removed = g_ptr_array_new_with_free_func ((GDestroyNotify) logical_monitor_free);
 
-  g_signal_emit (tracker, signals[MONITORS_CHANGED], 0);
+  update_monitors (tracker, monitors, removed_monitors, renamed);
+  update_logical_monitors (tracker, logical_monitors, renamed,
+                           added, changed, removed);
+
+  if (added->len > 0 || changed->len > 0 || removed->len > 0)
+    g_signal_emit (tracker, signals[MONITORS_CHANGED], 0,
+                   added, changed, removed);
+
+  /* More changes came in while we were fetching */
+  if (tracker->state_outdated)
+    sync_state (tracker);
 }
 
 static void
 sync_state (DisplayStateTracker *tracker)
 {
+  if (tracker->fetching_state)
+    {
+      tracker->state_outdated = TRUE;
+      return;
+    }
+
+  tracker->state_outdated = FALSE;
+  tracker->fetching_state = TRUE;
   org_gnome_mutter_display_config_call_get_current_state (tracker->proxy,
                                                           tracker->cancellable,
                                                           get_current_state_cb,
@@ -255,6 +427,12 @@ on_display_config_proxy_acquired (GObject      *object,
       return;
     }
 
+  if (tracker->proxy)
+    {
+      g_signal_handlers_disconnect_by_data (tracker->proxy, tracker);
+      g_object_unref (tracker->proxy);
+    }
+
   tracker->proxy = proxy;
 
   g_signal_connect (proxy, "monitors-changed",
@@ -321,6 +499,8 @@ display_state_tracker_init (DisplayStateTracker *tracker)
 {
   tracker->monitors = g_hash_table_new_full (g_str_hash, g_str_equal,
                                              NULL, (GDestroyNotify) monitor_free);
+  tracker->logical_monitors =
+    g_ptr_array_new_with_free_func ((GDestroyNotify) logical_monitor_free);
 }
 
 static void
@@ -331,5 +511,8 @@ display_state_tracker_class_init (DisplayStateTrackerClass *klass)
                                             G_SIGNAL_RUN_LAST,
                                             0,
                                             NULL, NULL, NULL,
-                                            G_TYPE_NONE, 0);
+                                            G_TYPE_NONE, 3,
+                                            G_TYPE_PTR_ARRAY,
+                                            G_TYPE_PTR_ARRAY,
+                                            G_TYPE_PTR_ARRAY);
 }
@@ -30,10 +30,10 @@ const char * monitor_get_connector (Monitor *monitor);
 
 const char * monitor_get_display_name (Monitor *monitor);
 
-GList * logical_monitor_get_monitors (LogicalMonitor *logical_monitor);
+GPtrArray * logical_monitor_get_monitors (LogicalMonitor *logical_monitor);
 
 gboolean logical_monitor_is_primary (LogicalMonitor *logical_monitor);
 
-GList * display_state_tracker_get_logical_monitors (DisplayStateTracker *tracker);
+GPtrArray * display_state_tracker_get_logical_monitors (DisplayStateTracker *tracker);
 
 DisplayStateTracker * display_state_tracker_get (void);
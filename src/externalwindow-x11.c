@@ -30,6 +30,11 @@
 
 static GdkDisplay *x11_display;
 
+/* Foreign windows by XID. Looking one up takes round trips to the X
+ * server, so they are kept until the server reports them destroyed.
+ */
+static GHashTable *foreign_windows;
+
 struct _ExternalWindowX11
 {
   ExternalWindow parent;
@@ -60,6 +65,57 @@ get_x11_display (void)
   return x11_display;
 }
 
+static GdkFilterReturn
+foreign_window_filter (GdkXEvent *gdk_xevent,
+                       GdkEvent  *event,
+                       gpointer   data)
+{
+  XEvent *xevent = gdk_xevent;
+
+  if (xevent->type == DestroyNotify)
+    g_hash_table_remove (foreign_windows,
+                         GSIZE_TO_POINTER (xevent->xdestroywindow.window));
+
+  return GDK_FILTER_CONTINUE;
+}
+
+static void
+foreign_window_free (gpointer data)
+{
+  GdkWindow *foreign_gdk_window = data;
+
+  gdk_window_remove_filter (foreign_gdk_window, foreign_window_filter, NULL);
+  g_object_unref (foreign_gdk_window);
+}
+
+static GdkWindow *
+lookup_foreign_window (GdkDisplay *display,
+                       Window      xid)
+{
+  GdkWindow *foreign_gdk_window;
+
+  if (foreign_windows == NULL)
+    foreign_windows = g_hash_table_new_full (NULL, NULL, NULL, foreign_window_free);
+
+  foreign_gdk_window = g_hash_table_lookup (foreign_windows, GSIZE_TO_POINTER (xid));
+  if (foreign_gdk_window && !gdk_window_is_destroyed (foreign_gdk_window))
+    return g_object_ref (foreign_gdk_window);
+
+  foreign_gdk_window = gdk_x11_window_foreign_new_for_display (display, xid);
+  if (!foreign_gdk_window)
+    return NULL;
+
+  /* Ask for DestroyNotify */
+  gdk_window_set_events (foreign_gdk_window,
+                         gdk_window_get_events (foreign_gdk_window) | GDK_STRUCTURE_MASK);
+  gdk_window_add_filter (foreign_gdk_window, foreign_window_filter, NULL);
+
+  g_hash_table_insert (foreign_windows, GSIZE_TO_POINTER (xid),
+                       g_object_ref (foreign_gdk_window));
+
+  return foreign_gdk_window;
+}
+
 ExternalWindowX11 *
 external_window_x11_new (const char *handle_str)
 {
@@ -83,7 +139,7 @@ external_window_x11_new (const char *handle_str)
       return NULL;
     }
 
-  foreign_gdk_window = gdk_x11_window_foreign_new_for_display (display, xid);
+  foreign_gdk_window = lookup_foreign_window (display, xid);
   if (!foreign_gdk_window)
     {
       g_warning ("Failed to create foreign window for XID %d", xid);
@@ -105,6 +161,7 @@ external_window_x11_set_parent_of (ExternalWindow *external_window,
   ExternalWindowX11 *external_window_x11 =
     EXTERNAL_WINDOW_X11 (external_window);
 
+  /* This only sets WM_TRANSIENT_FOR, no reply is waited for */
   gdk_window_set_transient_for (child_window,
                                 external_window_x11->foreign_gdk_window);
 }
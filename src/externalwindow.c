@@ -44,8 +44,13 @@ typedef struct _ExternalWindowPrivate
 
 G_DEFINE_TYPE_WITH_PRIVATE (ExternalWindow, external_window, G_TYPE_OBJECT)
 
-ExternalWindow *
-create_external_window_from_handle (const char *handle_str)
+/* Maps handle strings to the external windows that are currently in
+ * use, so that dialogs for the same parent share one.
+ */
+static GHashTable *external_windows;
+
+static ExternalWindow *
+create_external_window (const char *handle_str)
 {
 #ifdef HAVE_GTK_X11
     {
@@ -79,6 +84,68 @@ create_external_window_from_handle (const char *handle_str)
   return NULL;
 }
 
+static void
+external_window_finalized (gpointer data,
+                           GObject *where_the_object_was)
+{
+  g_hash_table_remove (external_windows, data);
+}
+
+ExternalWindow *
+create_external_window_from_handle (const char *handle_str)
+{
+  ExternalWindow *external_window;
+  char *key;
+
+  if (external_windows == NULL)
+    external_windows = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+  external_window = g_hash_table_lookup (external_windows, handle_str);
+  if (external_window)
+    return g_object_ref (external_window);
+
+  external_window = create_external_window (handle_str);
+  if (external_window == NULL)
+    return NULL;
+
+  key = g_strdup (handle_str);
+  g_hash_table_insert (external_windows, key, external_window);
+  g_object_weak_ref (G_OBJECT (external_window), external_window_finalized, key);
+
+  return external_window;
+}
+
+/* Dialogs are made transient for a toplevel on the right screen, which
+ * is never shown. One per screen is shared by all dialogs.
+ */
+GtkWidget *
+get_fake_parent_for_external_window (ExternalWindow *external_window)
+{
+  GdkDisplay *display;
+  GdkScreen *screen;
+  GtkWidget *fake_parent;
+
+  if (external_window)
+    display = external_window_get_display (external_window);
+  else
+    display = gdk_display_get_default ();
+  screen = gdk_display_get_default_screen (display);
+
+  fake_parent = g_object_get_data (G_OBJECT (screen), "portal-fake-parent");
+  if (fake_parent == NULL)
+    {
+      fake_parent = g_object_new (GTK_TYPE_WINDOW,
+                                  "type", GTK_WINDOW_TOPLEVEL,
+                                  "screen", screen,
+                                  NULL);
+      g_object_ref_sink (fake_parent);
+      g_object_set_data_full (G_OBJECT (screen), "portal-fake-parent",
+                              fake_parent, g_object_unref);
+    }
+
+  return fake_parent;
+}
+
 void
 external_window_set_parent_of (ExternalWindow *external_window,
                                GdkWindow      *child_window)
@@ -48,6 +48,8 @@ struct _ExternalWindowClass
 GType external_window_get_type (void);
 ExternalWindow *create_external_window_from_handle (const char *handle_str);
 
+GtkWidget *get_fake_parent_for_external_window (ExternalWindow *external_window);
+
 void external_window_set_parent_of (ExternalWindow *external_window,
                                     GdkWindow      *child_window);
 
@@ -307,7 +307,8 @@ handle_close (XdpImplRequest *object,
   if (handle->request->exported)
     request_unexport (handle->request);
 
-  xdp_impl_request_complete_close (object, invocation);
+  if (invocation)
+    xdp_impl_request_complete_close (object, invocation);
 
   return TRUE;
 }
@@ -350,8 +351,6 @@ handle_open (XdpImplFileChooser *object,
   GtkFileChooserAction action;
   gboolean multiple;
   gboolean modal;
-  GdkDisplay *display;
-  GdkScreen *screen;
   GtkWidget *dialog;
   ExternalWindow *external_parent = NULL;
   GtkWidget *fake_parent;
@@ -404,17 +403,7 @@ handle_open (XdpImplFileChooser *object,
                    arg_parent_window);
     }
 
-  if (external_parent)
-    display = external_window_get_display (external_parent);
-  else
-    display = gdk_display_get_default ();
-  screen = gdk_display_get_default_screen (display);
-
-  fake_parent = g_object_new (GTK_TYPE_WINDOW,
-                              "type", GTK_WINDOW_TOPLEVEL,
-                              "screen", screen,
-                              NULL);
-  g_object_ref_sink (fake_parent);
+  fake_parent = get_fake_parent_for_external_window (external_parent);
 
   dialog = gtk_file_chooser_dialog_new (arg_title, GTK_WINDOW (fake_parent), action,
                                         cancel_label, GTK_RESPONSE_CANCEL,
@@ -538,8 +527,6 @@ handle_open (XdpImplFileChooser *object,
         gtk_file_chooser_select_filename (GTK_FILE_CHOOSER (dialog), path);
     }
 
-  g_object_unref (fake_parent);
-
   gtk_file_chooser_set_do_overwrite_confirmation (GTK_FILE_CHOOSER (dialog), TRUE);
 
   if (action == GTK_FILE_CHOOSER_ACTION_OPEN)
@@ -19,6 +19,7 @@
 #include "gnomescreencast.h"
 #include "screencastwidget.h"
 #include "shell-dbus.h"
+#include "trace.h"
 
 #include <stdint.h>
 
@@ -497,12 +498,15 @@ gnome_screen_cast_session_start (GnomeScreenCastSession *gnome_screen_cast_sessi
 {
   OrgGnomeMutterScreenCastSession *session_proxy =
     gnome_screen_cast_session->proxy;
+  gint64 start_time = TRACE_CURRENT_TIME;
 
   if (!org_gnome_mutter_screen_cast_session_call_start_sync (session_proxy,
                                                              NULL,
                                                              error))
     return FALSE;
 
+  trace_mark (start_time, TRACE_CURRENT_TIME - start_time, "dbus-call", "Start");
+
   return TRUE;
 }
 
@@ -565,6 +569,7 @@ gnome_screen_cast_create_session (GnomeScreenCast *gnome_screen_cast,
   GDBusConnection *connection;
   OrgGnomeMutterScreenCastSession *session_proxy;
   GnomeScreenCastSession *gnome_screen_cast_session;
+  gint64 start_time;
 
   g_variant_builder_init (&properties_builder, G_VARIANT_TYPE_VARDICT);
   if (remote_desktop_session_id)
@@ -574,12 +579,14 @@ gnome_screen_cast_create_session (GnomeScreenCast *gnome_screen_cast,
                              g_variant_new_string (remote_desktop_session_id));
     }
   properties = g_variant_builder_end (&properties_builder);
+  start_time = TRACE_CURRENT_TIME;
   if (!org_gnome_mutter_screen_cast_call_create_session_sync (gnome_screen_cast->proxy,
                                                               properties,
                                                               &session_path,
                                                               NULL,
                                                               error))
     return NULL;
+  trace_mark (start_time, TRACE_CURRENT_TIME - start_time, "dbus-call", "CreateSession");
 
   connection = g_dbus_proxy_get_connection (G_DBUS_PROXY (gnome_screen_cast->proxy));
   session_proxy =
@@ -0,0 +1,296 @@
+/*
+ * Copyright © 2026 xdg-desktop-portal-gtk contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "config.h"
+
+#include "iconcache.h"
+
+/* A process-wide cache of decoded icons, keyed by icon, size and scale.
+ * Icons are decoded by gtk_icon_info_load_icon_async(), off the main
+ * thread, and kept as surfaces so they render at the right scale. The
+ * least recently used icons are dropped beyond ICON_CACHE_SIZE.
+ */
+
+#define ICON_CACHE_SIZE 256
+#define PLACEHOLDER_ICON "application-x-executable"
+
+enum
+{
+  ICON_LOADED,
+  ICONS_CHANGED,
+
+  N_SIGNALS
+};
+
+static guint signals[N_SIGNALS];
+
+typedef struct
+{
+  GIcon *icon;
+  int size;
+  int scale;
+
+  /* NULL while loading */
+  cairo_surface_t *surface;
+  GList link;
+} IconCacheEntry;
+
+struct _IconCache
+{
+  GObject parent;
+
+  GHashTable *entries;
+  GQueue lru;
+  GHashTable *placeholders;
+};
+
+G_DEFINE_TYPE (IconCache, icon_cache, G_TYPE_OBJECT)
+
+static IconCache *_icon_cache;
+
+static guint
+entry_hash (gconstpointer data)
+{
+  const IconCacheEntry *entry = data;
+
+  return g_icon_hash ((gpointer) entry->icon) ^ (entry->size << 4) ^ entry->scale;
+}
+
+static gboolean
+entry_equal (gconstpointer a,
+             gconstpointer b)
+{
+  const IconCacheEntry *entry_a = a;
+  const IconCacheEntry *entry_b = b;
+
+  return entry_a->size == entry_b->size &&
+         entry_a->scale == entry_b->scale &&
+         g_icon_equal (entry_a->icon, entry_b->icon);
+}
+
+static void
+entry_free (gpointer data)
+{
+  IconCacheEntry *entry = data;
+
+  g_object_unref (entry->icon);
+  g_clear_pointer (&entry->surface, cairo_surface_destroy);
+
+  g_free (entry);
+}
+
+static IconCacheEntry *
+lookup_entry (IconCache *cache,
+              GIcon *icon,
+              int size,
+              int scale)
+{
+  IconCacheEntry key = { .icon = icon, .size = size, .scale = scale };
+
+  return g_hash_table_lookup (cache->entries, &key);
+}
+
+cairo_surface_t *
+icon_cache_get_placeholder (IconCache *cache,
+                            int size,
+                            int scale)
+{
+  gpointer key = GINT_TO_POINTER ((size << 8) | scale);
+  cairo_surface_t *surface;
+
+  surface = g_hash_table_lookup (cache->placeholders, key);
+  if (surface == NULL)
+    {
+      g_autoptr(GdkPixbuf) pixbuf = NULL;
+
+      pixbuf = gtk_icon_theme_load_icon_for_scale (gtk_icon_theme_get_default (),
+                                                   PLACEHOLDER_ICON,
+                                                   size, scale,
+                                                   GTK_ICON_LOOKUP_FORCE_SIZE,
+                                                   NULL);
+      if (pixbuf)
+        {
+          surface = gdk_cairo_surface_create_from_pixbuf (pixbuf, scale, NULL);
+        }
+      else
+        {
+          surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32,
+                                                size * scale, size * scale);
+          cairo_surface_set_device_scale (surface, scale, scale);
+        }
+
+      g_hash_table_insert (cache->placeholders, key, surface);
+    }
+
+  return surface;
+}
+
+static void
+icon_loaded (IconCache *cache,
+             IconCacheEntry *entry,
+             GdkPixbuf *pixbuf)
+{
+  if (pixbuf)
+    entry->surface = gdk_cairo_surface_create_from_pixbuf (pixbuf, entry->scale, NULL);
+  else
+    entry->surface = cairo_surface_reference (icon_cache_get_placeholder (cache,
+                                                                          entry->size,
+                                                                          entry->scale));
+
+  g_queue_push_head_link (&cache->lru, &entry->link);
+
+  while (g_queue_get_length (&cache->lru) > ICON_CACHE_SIZE)
+    {
+      IconCacheEntry *old = g_queue_peek_tail (&cache->lru);
+
+      g_queue_unlink (&cache->lru, &old->link);
+      g_hash_table_remove (cache->entries, old);
+    }
+
+  g_signal_emit (cache, signals[ICON_LOADED], 0, entry->icon);
+}
+
+static void
+icon_info_loaded (GObject *source_object,
+                  GAsyncResult *result,
+                  gpointer data)
+{
+  IconCacheEntry *entry = data;
+  g_autoptr(GdkPixbuf) pixbuf = NULL;
+  g_autoptr(GError) error = NULL;
+
+  pixbuf = gtk_icon_info_load_icon_finish (GTK_ICON_INFO (source_object), result, &error);
+  if (pixbuf == NULL)
+    g_debug ("Failed to load icon: %s", error->message);
+
+  icon_loaded (icon_cache_get (), entry, pixbuf);
+}
+
+/* Returns the cached surface for the icon, or NULL if it
+ * has not been loaded yet.
+ */
+cairo_surface_t *
+icon_cache_lookup (IconCache *cache,
+                   GIcon *icon,
+                   int size,
+                   int scale)
+{
+  IconCacheEntry *entry;
+
+  entry = lookup_entry (cache, icon, size, scale);
+  if (entry == NULL || entry->surface == NULL)
+    return NULL;
+
+  g_queue_unlink (&cache->lru, &entry->link);
+  g_queue_push_head_link (&cache->lru, &entry->link);
+
+  return entry->surface;
+}
+
+/* Starts loading the icon, unless it is already loaded or loading;
+ * ::icon-loaded is emitted when it is available.
+ */
+void
+icon_cache_load (IconCache *cache,
+                 GIcon *icon,
+                 int size,
+                 int scale)
+{
+  IconCacheEntry *entry;
+  GtkIconInfo *info;
+
+  if (lookup_entry (cache, icon, size, scale) != NULL)
+    return;
+
+  entry = g_new0 (IconCacheEntry, 1);
+  entry->icon = g_object_ref (icon);
+  entry->size = size;
+  entry->scale = scale;
+  entry->link.data = entry;
+  g_hash_table_add (cache->entries, entry);
+
+  info = gtk_icon_theme_lookup_by_gicon_for_scale (gtk_icon_theme_get_default (),
+                                                   icon, size, scale,
+                                                   GTK_ICON_LOOKUP_FORCE_SIZE);
+  if (info == NULL)
+    {
+      icon_loaded (cache, entry, NULL);
+      return;
+    }
+
+  gtk_icon_info_load_icon_async (info, NULL, icon_info_loaded, entry);
+  g_object_unref (info);
+}
+
+static void
+icon_theme_changed (GtkIconTheme *icon_theme,
+                    IconCache *cache)
+{
+  IconCacheEntry *entry;
+
+  /* Icons that are still loading stay, their callbacks refer to them */
+  while ((entry = g_queue_pop_head (&cache->lru)) != NULL)
+    g_hash_table_remove (cache->entries, entry);
+
+  g_hash_table_remove_all (cache->placeholders);
+
+  /* Everything shown so far is from the old theme */
+  g_signal_emit (cache, signals[ICONS_CHANGED], 0);
+}
+
+IconCache *
+icon_cache_get (void)
+{
+  IconCache *cache;
+
+  if (_icon_cache)
+    return _icon_cache;
+
+  cache = g_object_new (icon_cache_get_type (), NULL);
+  g_signal_connect (gtk_icon_theme_get_default (), "changed",
+                    G_CALLBACK (icon_theme_changed), cache);
+
+  _icon_cache = cache;
+  return cache;
+}
+
+static void
+icon_cache_init (IconCache *cache)
+{
+  cache->entries = g_hash_table_new_full (entry_hash, entry_equal, entry_free, NULL);
+  cache->placeholders = g_hash_table_new_full (NULL, NULL, NULL,
+                                               (GDestroyNotify) cairo_surface_destroy);
+}
+
+static void
+icon_cache_class_init (IconCacheClass *klass)
+{
+  signals[ICON_LOADED] = g_signal_new ("icon-loaded",
+                                       G_TYPE_FROM_CLASS (klass),
+                                       G_SIGNAL_RUN_LAST,
+                                       0,
+                                       NULL, NULL, NULL,
+                                       G_TYPE_NONE, 1,
+                                       G_TYPE_ICON);
+  signals[ICONS_CHANGED] = g_signal_new ("icons-changed",
+                                         G_TYPE_FROM_CLASS (klass),
+                                         G_SIGNAL_RUN_LAST,
+                                         0,
+                                         NULL, NULL, NULL,
+                                         G_TYPE_NONE, 0);
+}
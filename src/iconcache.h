@@ -0,0 +1,39 @@
+/*
+ * Copyright © 2026 xdg-desktop-portal-gtk contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include <gtk/gtk.h>
+
+G_DECLARE_FINAL_TYPE (IconCache, icon_cache, ICON, CACHE, GObject)
+
+IconCache *       icon_cache_get             (void);
+
+cairo_surface_t * icon_cache_lookup          (IconCache *cache,
+                                              GIcon     *icon,
+                                              int        size,
+                                              int        scale);
+
+void              icon_cache_load            (IconCache *cache,
+                                              GIcon     *icon,
+                                              int        size,
+                                              int        scale);
+
+cairo_surface_t * icon_cache_get_placeholder (IconCache *cache,
+                                              int        size,
+                                              int        scale);
@@ -24,6 +24,7 @@ enum {
 static GDBusInterfaceSkeleton *inhibit;
 static OrgGnomeSessionManager *sessionmanager;
 static OrgGnomeScreenSaver *screensaver;
+static OrgFreedesktopScreenSaver *fdo_screensaver;
 static GDBusProxy *client;
 
 typedef enum {
@@ -37,6 +38,76 @@ static SessionState session_state = RUNNING;
 static gboolean screensaver_active = FALSE;
 static guint query_end_timeout;
 
+/* How long we wait for QueryEndResponse calls adapts to how long the
+ * slowest monitor took in previous rounds, within these bounds (in ms).
+ * Monitors have always been given at least 1 s, so only slow monitors
+ * get more time.
+ */
+#define QUERY_END_TIMEOUT_MIN 1000
+#define QUERY_END_TIMEOUT_MAX 3000
+
+static guint pending_query_end_responses;
+static gint64 query_end_start_time;
+static gint64 query_end_slowest_response;
+static guint query_end_estimate = 500; /* starts out with a 1 s timeout */
+
+/* Inhibitions are shared between requests with the same app id, flags
+ * and reason, with one upstream inhibition each. Apps that re-inhibit
+ * often, e.g. on every track change, would otherwise cause a stream of
+ * Inhibit and Uninhibit calls, so an inhibition is kept for a little
+ * while after its last request is closed.
+ */
+
+#define INHIBIT_GRACE_PERIOD 2 /* seconds */
+
+typedef struct {
+  char *key;
+  char *app_id;
+  char *reason;
+  guint flags;
+
+  guint refcount;
+  guint cookie;
+  gboolean inhibiting;
+  gboolean released;
+  gboolean failed;
+  guint release_id;
+
+  /* Inhibit calls waiting for the upstream inhibition */
+  GPtrArray *pending;
+} Inhibition;
+
+typedef struct {
+  XdpImplInhibit *object;
+  GDBusMethodInvocation *invocation;
+  Request *request;
+} PendingInhibit;
+
+static GHashTable *inhibitions;
+
+static void
+pending_inhibit_free (gpointer data)
+{
+  PendingInhibit *pending = data;
+
+  g_object_unref (pending->request);
+
+  g_free (pending);
+}
+
+static void
+inhibition_free (gpointer data)
+{
+  Inhibition *inhibition = data;
+
+  g_clear_pointer (&inhibition->pending, g_ptr_array_unref);
+  g_free (inhibition->key);
+  g_free (inhibition->app_id);
+  g_free (inhibition->reason);
+
+  g_free (inhibition);
+}
+
 static void
 uninhibit_done_gnome (GObject *source,
                       GAsyncResult *result,
@@ -48,29 +119,102 @@ uninhibit_done_gnome (GObject *source,
     g_warning ("Backend call failed: %s", error->message);
 }
 
-static gboolean
-handle_close_gnome (XdpImplRequest *object,
-                    GDBusMethodInvocation *invocation,
+static void
+uninhibit_done_fdo (GObject *source,
+                    GAsyncResult *result,
                     gpointer data)
 {
-  Request *request = (Request *)object;
-  guint cookie;
+  g_autoptr(GError) error = NULL;
 
-  /* If we get a Close call before the Inhibit call returned,
-   * delay the uninhibit call until we have the cookie.
-   */
-  cookie = GPOINTER_TO_UINT (g_object_get_data (G_OBJECT (request), "cookie"));
-  if (cookie)
-    org_gnome_session_manager_call_uninhibit (sessionmanager, cookie, NULL, uninhibit_done_gnome, NULL);
-  else
-    g_object_set_data (G_OBJECT (request), "closed", GINT_TO_POINTER (1));
+  if (!org_freedesktop_screen_saver_call_un_inhibit_finish (fdo_screensaver,
+                                                            result,
+                                                            &error))
+    g_warning ("Backend call failed: %s", error->message);
+}
 
-  if (request->exported)
-    request_unexport (request);
+static void
+inhibition_uninhibit (Inhibition *inhibition)
+{
+  g_debug ("Uninhibiting %s for %s", inhibition->reason, inhibition->app_id);
 
-  xdp_impl_request_complete_close (object, invocation);
+  if (inhibition->cookie != 0)
+    {
+      if (sessionmanager)
+        org_gnome_session_manager_call_uninhibit (sessionmanager,
+                                                  inhibition->cookie,
+                                                  NULL,
+                                                  uninhibit_done_gnome,
+                                                  NULL);
+      else
+        org_freedesktop_screen_saver_call_un_inhibit (fdo_screensaver,
+                                                      inhibition->cookie,
+                                                      NULL,
+                                                      uninhibit_done_fdo,
+                                                      NULL);
+    }
 
-  return TRUE;
+  g_hash_table_remove (inhibitions, inhibition->key);
+}
+
+/* A failed inhibition is taken out of the table right away, so that
+ * the next request tries again, and the requests waiting for it get
+ * the error.
+ */
+static void
+inhibition_fail (Inhibition *inhibition,
+                 const GError *error)
+{
+  g_autoptr(GPtrArray) pending = g_steal_pointer (&inhibition->pending);
+  guint i;
+
+  inhibition->inhibiting = FALSE;
+  inhibition->failed = TRUE;
+  g_hash_table_steal (inhibitions, inhibition->key);
+
+  /* Keep the inhibition around while the requests let go of it */
+  inhibition->refcount++;
+
+  for (i = 0; i < pending->len; i++)
+    {
+      PendingInhibit *p = g_ptr_array_index (pending, i);
+
+      g_dbus_method_invocation_return_gerror (p->invocation, error);
+
+      g_object_set_data (G_OBJECT (p->request), "inhibition", NULL);
+      if (p->request->exported)
+        request_unexport (p->request);
+    }
+
+  if (--inhibition->refcount == 0)
+    {
+      if (inhibition->release_id != 0)
+        g_source_remove (inhibition->release_id);
+      inhibition_free (inhibition);
+    }
+}
+
+static void
+inhibition_set_cookie (Inhibition *inhibition,
+                       guint cookie)
+{
+  g_autoptr(GPtrArray) pending = g_steal_pointer (&inhibition->pending);
+  guint i;
+
+  inhibition->inhibiting = FALSE;
+  inhibition->cookie = cookie;
+
+  for (i = 0; i < pending->len; i++)
+    {
+      PendingInhibit *p = g_ptr_array_index (pending, i);
+
+      xdp_impl_inhibit_complete_inhibit (p->object, p->invocation);
+    }
+
+  /* If the grace period ran out before the Inhibit call returned,
+   * the uninhibit call was delayed until we have the cookie.
+   */
+  if (inhibition->released)
+    inhibition_uninhibit (inhibition);
 }
 
 static void
@@ -78,66 +222,241 @@ inhibit_done_gnome (GObject *source,
                     GAsyncResult *result,
                     gpointer data)
 {
-  g_autoptr(Request) request = data;
+  Inhibition *inhibition = data;
   guint cookie = 0;
-  gboolean closed;
   g_autoptr(GError) error = NULL;
 
   if (!org_gnome_session_manager_call_inhibit_finish (sessionmanager, &cookie, result, &error))
-    g_warning ("Backend call failed: %s", error->message);
+    {
+      g_warning ("Backend call failed: %s", error->message);
+      inhibition_fail (inhibition, error);
+      return;
+    }
+
+  inhibition_set_cookie (inhibition, cookie);
+}
+
+static void
+inhibit_done_fdo (GObject *source,
+                  GAsyncResult *result,
+                  gpointer data)
+{
+  Inhibition *inhibition = data;
+  guint cookie = 0;
+  g_autoptr(GError) error = NULL;
 
-  closed = GPOINTER_TO_UINT (g_object_get_data (G_OBJECT (request), "closed"));
+  if (!org_freedesktop_screen_saver_call_inhibit_finish (fdo_screensaver,
+                                                         &cookie,
+                                                         result,
+                                                         &error))
+    {
+      g_warning ("Backend call failed: %s", error->message);
+      inhibition_fail (inhibition, error);
+      return;
+    }
 
-  if (closed)
-    org_gnome_session_manager_call_uninhibit (sessionmanager, cookie, NULL, uninhibit_done_gnome, NULL);
+  inhibition_set_cookie (inhibition, cookie);
+}
+
+static Inhibition *
+inhibition_acquire (const char *app_id,
+                    guint flags,
+                    const char *reason)
+{
+  g_autofree char *key = NULL;
+  Inhibition *inhibition;
+
+  key = g_strdup_printf ("%s\n%u\n%s", app_id, flags, reason);
+
+  inhibition = g_hash_table_lookup (inhibitions, key);
+  if (inhibition)
+    {
+      if (inhibition->release_id != 0)
+        {
+          g_source_remove (inhibition->release_id);
+          inhibition->release_id = 0;
+        }
+      inhibition->released = FALSE;
+      inhibition->refcount++;
+
+      return inhibition;
+    }
+
+  g_debug ("Inhibiting %s for %s", reason, app_id);
+
+  inhibition = g_new0 (Inhibition, 1);
+  inhibition->key = g_steal_pointer (&key);
+  inhibition->app_id = g_strdup (app_id);
+  inhibition->reason = g_strdup (reason);
+  inhibition->flags = flags;
+  inhibition->refcount = 1;
+  inhibition->inhibiting = TRUE;
+  inhibition->pending = g_ptr_array_new_with_free_func (pending_inhibit_free);
+  g_hash_table_insert (inhibitions, inhibition->key, inhibition);
+
+  if (sessionmanager)
+    org_gnome_session_manager_call_inhibit (sessionmanager,
+                                            app_id,
+                                            0, /* window */
+                                            reason,
+                                            flags,
+                                            NULL,
+                                            inhibit_done_gnome,
+                                            inhibition);
   else
-    g_object_set_data (G_OBJECT (request), "cookie", GUINT_TO_POINTER (cookie));
+    org_freedesktop_screen_saver_call_inhibit (fdo_screensaver,
+                                               app_id,
+                                               reason,
+                                               NULL,
+                                               inhibit_done_fdo,
+                                               inhibition);
+
+  return inhibition;
 }
 
 static gboolean
-handle_inhibit_gnome (XdpImplInhibit *object,
-                      GDBusMethodInvocation *invocation,
-                      const gchar *arg_handle,
-                      const gchar *arg_app_id,
-                      const gchar *arg_window,
-                      guint arg_flags,
-                      GVariant *arg_options)
+inhibition_grace_period_over (gpointer data)
+{
+  Inhibition *inhibition = data;
+
+  inhibition->release_id = 0;
+  inhibition->released = TRUE;
+
+  if (!inhibition->inhibiting)
+    inhibition_uninhibit (inhibition);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+inhibition_release (gpointer data)
+{
+  Inhibition *inhibition = data;
+
+  if (--inhibition->refcount > 0)
+    return;
+
+  /* Failed inhibitions are no longer in the table */
+  if (inhibition->failed)
+    {
+      inhibition_free (inhibition);
+      return;
+    }
+
+  inhibition->release_id = g_timeout_add_seconds (INHIBIT_GRACE_PERIOD,
+                                                  inhibition_grace_period_over,
+                                                  inhibition);
+}
+
+static gboolean
+handle_close (XdpImplRequest *object,
+              GDBusMethodInvocation *invocation,
+              gpointer data)
+{
+  Request *request = (Request *)object;
+
+  g_object_set_data (G_OBJECT (request), "inhibition", NULL);
+
+  if (request->exported)
+    request_unexport (request);
+
+  if (invocation)
+    xdp_impl_request_complete_close (object, invocation);
+
+  return TRUE;
+}
+
+static void
+inhibit_for_request (XdpImplInhibit *object,
+                     GDBusMethodInvocation *invocation,
+                     const gchar *arg_handle,
+                     const gchar *arg_app_id,
+                     guint arg_flags,
+                     GVariant *arg_options)
 {
   g_autoptr (Request) request = NULL;
   const char *sender;
-  g_autoptr(GError) error = NULL;
   const char *reason;
+  Inhibition *inhibition;
 
   sender = g_dbus_method_invocation_get_sender (invocation);
 
   request = request_new (sender, arg_app_id, arg_handle);
 
-  g_signal_connect (request, "handle-close", G_CALLBACK (handle_close_gnome), NULL);
+  g_signal_connect (request, "handle-close", G_CALLBACK (handle_close), NULL);
 
   request_export (request, g_dbus_method_invocation_get_connection (invocation));
 
   if (!g_variant_lookup (arg_options, "reason", "&s", &reason))
     reason = "";
 
-  org_gnome_session_manager_call_inhibit (sessionmanager,
-                                          arg_app_id,
-                                          0, /* window */
-                                          reason,
-                                          arg_flags,
-                                          NULL,
-                                          inhibit_done_gnome,
-                                          g_object_ref (request));
+  inhibition = inhibition_acquire (arg_app_id, arg_flags, reason);
+  g_object_set_data_full (G_OBJECT (request), "inhibition",
+                          inhibition, inhibition_release);
+
+  if (inhibition->inhibiting)
+    {
+      PendingInhibit *pending = g_new0 (PendingInhibit, 1);
+
+      pending->object = object;
+      pending->invocation = invocation;
+      pending->request = g_object_ref (request);
+      g_ptr_array_add (inhibition->pending, pending);
+      return;
+    }
 
   xdp_impl_inhibit_complete_inhibit (object, invocation);
+}
+
+static gboolean
+handle_inhibit_gnome (XdpImplInhibit *object,
+                      GDBusMethodInvocation *invocation,
+                      const gchar *arg_handle,
+                      const gchar *arg_app_id,
+                      const gchar *arg_window,
+                      guint arg_flags,
+                      GVariant *arg_options)
+{
+  inhibit_for_request (object, invocation, arg_handle, arg_app_id, arg_flags, arg_options);
 
   return TRUE;
 }
 
+static gboolean
+handle_inhibit_fdo (XdpImplInhibit *object,
+                    GDBusMethodInvocation *invocation,
+                    const gchar *arg_handle,
+                    const gchar *arg_app_id,
+                    const gchar *arg_window,
+                    guint arg_flags,
+                    GVariant *arg_options)
+{
+  if ((arg_flags & ~INHIBIT_IDLE) != 0)
+    {
+      g_dbus_method_invocation_return_error (invocation,
+                                             XDG_DESKTOP_PORTAL_ERROR,
+                                             XDG_DESKTOP_PORTAL_ERROR_FAILED,
+                                             "Inhibiting other than idle not supported");
+      return TRUE;
+    }
+
+  inhibit_for_request (object, invocation, arg_handle, arg_app_id, arg_flags, arg_options);
+
+  return TRUE;
+}
+
+static void flush_state_changed (void);
+
 static void
 send_quit_response (GDBusProxy  *client,
                     gboolean     will_quit,
                     const gchar *reason)
 {
+  /* Monitors must see the new session state before the session
+   * manager hears back from us and moves on.
+   */
+  flush_state_changed ();
+
   g_debug ("Calling EndSessionResponse %d '%s'", will_quit, reason ? reason : "");
 
   g_dbus_proxy_call (client,
@@ -165,7 +484,20 @@ set_session_state (SessionState state)
 }
 
 static void global_set_pending_query_end_response (gboolean pending);
-static gboolean global_get_pending_query_end_response (void);
+
+static guint
+get_query_end_timeout (void)
+{
+  return CLAMP (2 * query_end_estimate, QUERY_END_TIMEOUT_MIN, QUERY_END_TIMEOUT_MAX);
+}
+
+static void
+update_query_end_estimate (guint response_time)
+{
+  query_end_estimate = (3 * query_end_estimate + response_time) / 4;
+
+  g_debug ("Next QueryEndResponse timeout: %u ms", get_query_end_timeout ());
+}
 
 static void
 stop_waiting_for_query_end_response (gboolean send_response)
@@ -178,7 +510,8 @@ stop_waiting_for_query_end_response (gboolean send_response)
       query_end_timeout = 0;
     }
 
-  global_set_pending_query_end_response (FALSE);
+  if (pending_query_end_responses > 0)
+    global_set_pending_query_end_response (FALSE);
 
   if (send_response && client)
     send_quit_response (client, TRUE, NULL);
@@ -187,8 +520,13 @@ stop_waiting_for_query_end_response (gboolean send_response)
 static gboolean
 query_end_response (gpointer data)
 {
-  g_debug ("1 second wait is over");
+  g_debug ("Wait for QueryEndResponse calls is over, %u missing",
+           pending_query_end_responses);
+
+  /* We don't know how long the missing responses would have taken */
+  update_query_end_estimate (2 * get_query_end_timeout ());
 
+  query_end_timeout = 0;
   stop_waiting_for_query_end_response (TRUE);
 
   return G_SOURCE_REMOVE;
@@ -197,13 +535,19 @@ query_end_response (gpointer data)
 static void
 wait_for_query_end_response (GDBusProxy *proxy)
 {
+  guint timeout;
+
   if (query_end_timeout != 0)
     return; /* we're already waiting */
 
-  g_debug ("Waiting for up to 1 second for QueryEndResponse calls");
+  timeout = get_query_end_timeout ();
+
+  g_debug ("Waiting for up to %u ms for QueryEndResponse calls", timeout);
+
+  query_end_timeout = g_timeout_add (timeout, query_end_response, proxy);
+  query_end_start_time = g_get_monotonic_time ();
+  query_end_slowest_response = 0;
 
-  query_end_timeout = g_timeout_add (1000, query_end_response, proxy);
-  
   global_set_pending_query_end_response (TRUE);
 }
 
@@ -216,9 +560,12 @@ maybe_send_quit_response (void)
   if (!client)
     return;
 
-  if (global_get_pending_query_end_response ())
+  if (pending_query_end_responses > 0)
     return;
 
+  if (query_end_slowest_response > 0)
+    update_query_end_estimate (query_end_slowest_response / 1000);
+
   g_debug ("No more pending QueryEndResponse calls");
 
   stop_waiting_for_query_end_response (TRUE);
@@ -257,146 +604,71 @@ client_proxy_signal (GDBusProxy  *proxy,
     }
 }
 
-static OrgFreedesktopScreenSaver *fdo_screensaver;
-
-static void
-uninhibit_done_fdo (GObject *source,
-                    GAsyncResult *result,
-                    gpointer data)
-{
-  g_autoptr(GError) error = NULL;
+static GList *active_sessions = NULL;
 
-  if (!org_freedesktop_screen_saver_call_un_inhibit_finish (fdo_screensaver,
-                                                            result,
-                                                            &error))
-    g_warning ("Backend call failed: %s", error->message);
-}
+/* The state is the same for all sessions, so it is built once
+ * and shared until it changes.
+ */
+static GVariant *state;
+static guint state_changed_id;
 
-static gboolean
-handle_close_fdo (XdpImplRequest *object,
-                  GDBusMethodInvocation *invocation,
-                  gpointer data)
+static GVariant *
+get_state (void)
 {
-  Request *request = (Request *)object;
-  guint cookie;
-
-  /* If we get a Close call before the Inhibit call returned,
-   * delay the uninhibit call until we have the cookie.
-   */
-  cookie = GPOINTER_TO_UINT (g_object_get_data (G_OBJECT (request), "cookie"));
-  if (cookie)
-    org_freedesktop_screen_saver_call_un_inhibit (fdo_screensaver,
-                                                  cookie,
-                                                  NULL,
-                                                  uninhibit_done_fdo,
-                                                  NULL);
-  else
-    g_object_set_data (G_OBJECT (request), "closed", GINT_TO_POINTER (1));
-
-  if (request->exported)
-    request_unexport (request);
+  if (state == NULL)
+    {
+      GVariantBuilder builder;
 
-  xdp_impl_request_complete_close (object, invocation);
+      g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
+      g_variant_builder_add (&builder, "{sv}", "screensaver-active", g_variant_new_boolean (screensaver_active));
+      g_variant_builder_add (&builder, "{sv}", "session-state", g_variant_new_uint32 (session_state));
+      state = g_variant_ref_sink (g_variant_builder_end (&builder));
+    }
 
-  return TRUE;
+  return state;
 }
 
 static void
-inhibit_done_fdo (GObject *source,
-                  GAsyncResult *result,
-                  gpointer data)
+emit_state_changed (Session *session)
 {
-  g_autoptr(Request) request = data;
-  guint cookie = 0;
-  gboolean closed;
-  g_autoptr(GError) error = NULL;
-
-  if (!org_freedesktop_screen_saver_call_inhibit_finish (fdo_screensaver,
-                                                         &cookie,
-                                                         result,
-                                                         &error))
-    g_warning ("Backend call failed: %s", error->message);
-
-  closed = GPOINTER_TO_UINT (g_object_get_data (G_OBJECT (request), "closed"));
+  g_debug ("Emitting StateChanged for session %s", session->id);
 
-  if (closed)
-    org_freedesktop_screen_saver_call_un_inhibit (fdo_screensaver,
-                                                  cookie,
-                                                  NULL,
-                                                  uninhibit_done_fdo,
-                                                  NULL);
-  else
-    g_object_set_data (G_OBJECT (request), "cookie", GUINT_TO_POINTER (cookie));
+  g_signal_emit_by_name (inhibit, "state-changed", session->id, get_state ());
 }
 
 static gboolean
-handle_inhibit_fdo (XdpImplInhibit *object,
-                    GDBusMethodInvocation *invocation,
-                    const gchar *arg_handle,
-                    const gchar *arg_app_id,
-                    const gchar *arg_window,
-                    guint arg_flags,
-                    GVariant *arg_options)
+emit_state_changed_idle (gpointer data)
 {
-  g_autoptr (Request) request = NULL;
-  const char *sender;
-  g_autoptr(GError) error = NULL;
-  const char *reason;
-
-  if ((arg_flags & ~INHIBIT_IDLE) != 0)
-    {
-      g_dbus_method_invocation_return_error (invocation,
-                                             XDG_DESKTOP_PORTAL_ERROR,
-                                             XDG_DESKTOP_PORTAL_ERROR_FAILED,
-                                             "Inhibiting other than idle not supported");
-      return TRUE;
-    }
-
-  sender = g_dbus_method_invocation_get_sender (invocation);
-
-  request = request_new (sender, arg_app_id, arg_handle);
-
-  g_signal_connect (request, "handle-close", G_CALLBACK (handle_close_fdo), NULL);
-
-  request_export (request, g_dbus_method_invocation_get_connection (invocation));
-
-  if (!g_variant_lookup (arg_options, "reason", "&s", &reason))
-    reason = "";
+  GList *l;
 
-  org_freedesktop_screen_saver_call_inhibit (fdo_screensaver,
-                                             arg_app_id,
-                                             reason,
-                                             NULL,
-                                             inhibit_done_fdo,
-                                             g_object_ref (request));
+  state_changed_id = 0;
 
-  xdp_impl_inhibit_complete_inhibit (object, invocation);
+  for (l = active_sessions; l; l = l->next)
+    emit_state_changed ((Session *)l->data);
 
-  return TRUE;
+  return G_SOURCE_REMOVE;
 }
 
-static GList *active_sessions = NULL;
-
+/* Changes that happen together, like the screensaver activating
+ * during a session state transition, are sent out once.
+ */
 static void
-emit_state_changed (Session *session)
+global_emit_state_changed (void)
 {
-  GVariantBuilder state;
-
-  g_debug ("Emitting StateChanged for session %s", session->id);
+  g_clear_pointer (&state, g_variant_unref);
 
-  g_variant_builder_init (&state, G_VARIANT_TYPE_VARDICT);
-  g_variant_builder_add (&state, "{sv}", "screensaver-active", g_variant_new_boolean (screensaver_active));
-  g_variant_builder_add (&state, "{sv}", "session-state", g_variant_new_uint32 (session_state));
-  g_signal_emit_by_name (inhibit, "state-changed", session->id, g_variant_builder_end (&state)); 
+  if (state_changed_id == 0)
+    state_changed_id = g_idle_add (emit_state_changed_idle, NULL);
 }
 
 static void
-global_emit_state_changed (void)
+flush_state_changed (void)
 {
-  GList *l;
+  if (state_changed_id == 0)
+    return;
 
-  for (l = active_sessions; l; l = l->next)
-    emit_state_changed ((Session *)l->data);
+  g_source_remove (state_changed_id);
+  emit_state_changed_idle (NULL);
 }
 
 typedef struct
@@ -418,26 +690,28 @@ global_set_pending_query_end_response (gboolean pending)
 {
   GList *l;
 
+  pending_query_end_responses = 0;
+
   for (l = active_sessions; l; l = l->next)
     {
       InhibitSession *session = (InhibitSession *)l->data;
       session->pending_query_end_response = pending;
+      if (pending)
+        pending_query_end_responses++;
     }
 }
 
-static gboolean
-global_get_pending_query_end_response (void)
+static void
+query_end_response_received (InhibitSession *session)
 {
-  GList *l;
+  if (!session->pending_query_end_response)
+    return;
 
-  for (l = active_sessions; l; l = l->next)
-    {
-      InhibitSession *session = (InhibitSession *)l->data;
-      if (session->pending_query_end_response)
-        return TRUE;
-    }
+  session->pending_query_end_response = FALSE;
+  pending_query_end_responses--;
 
-  return FALSE;
+  query_end_slowest_response = MAX (query_end_slowest_response,
+                                    g_get_monotonic_time () - query_end_start_time);
 }
 
 static void
@@ -448,6 +722,14 @@ inhibit_session_close (Session *session)
   g_debug ("Closing inhibit session %s", ((Session *)inhibit_session)->id);
 
   active_sessions = g_list_remove (active_sessions, session);
+
+  /* Don't keep waiting for a response that won't come */
+  if (inhibit_session->pending_query_end_response)
+    {
+      inhibit_session->pending_query_end_response = FALSE;
+      pending_query_end_responses--;
+      maybe_send_quit_response ();
+    }
 }
 
 static void
@@ -534,7 +816,7 @@ handle_query_end_response (XdpImplInhibit *object,
 
   if (session)
     {
-      session->pending_query_end_response = FALSE;
+      query_end_response_received (session);
       maybe_send_quit_response ();
     }
  
@@ -564,6 +846,8 @@ inhibit_init (GDBusConnection *bus,
 
   inhibit = G_DBUS_INTERFACE_SKELETON (xdp_impl_inhibit_skeleton_new ());
 
+  inhibitions = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, inhibition_free);
+
   sessionmanager = org_gnome_session_manager_proxy_new_sync (bus,
                                                              G_DBUS_PROXY_FLAGS_DO_NOT_AUTO_START,
                                                              "org.gnome.SessionManager",
@@ -590,8 +874,8 @@ inhibit_init (GDBusConnection *bus,
       g_signal_connect (inhibit, "handle-query-end-response", G_CALLBACK (handle_query_end_response), NULL);
 
       g_signal_connect (screensaver, "active-changed", G_CALLBACK (global_active_changed_cb), NULL);
-      org_gnome_screen_saver_call_get_active_sync (screensaver, &active, NULL, NULL);
-      g_object_set_data (G_OBJECT (screensaver), "active", GINT_TO_POINTER (active));
+      if (org_gnome_screen_saver_call_get_active_sync (screensaver, &active, NULL, NULL))
+        screensaver_active = active;
 
       g_debug ("Using org.gnome.SessionManager for inhibit");
       g_debug ("Using org.gnome.Screensaver for screensaver state");
@@ -636,8 +920,8 @@ inhibit_init (GDBusConnection *bus,
                                                                   NULL);
 
       g_signal_connect (fdo_screensaver, "active-changed", G_CALLBACK (global_active_changed_cb), NULL);
-      org_freedesktop_screen_saver_call_get_active_sync (fdo_screensaver, &active, NULL, NULL);
-      g_object_set_data (G_OBJECT (fdo_screensaver), "active", GINT_TO_POINTER (active));
+      if (org_freedesktop_screen_saver_call_get_active_sync (fdo_screensaver, &active, NULL, NULL))
+        screensaver_active = active;
 
       g_debug ("Using org.freedesktop.ScreenSaver for inhibit");
       g_debug ("Using org.freedesktop.ScreenSaver for screensaver state");
@@ -0,0 +1,564 @@
+/*
+ * Copyright © 2026 xdg-desktop-portal-gtk contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/* Stand-in for org.gnome.Mutter.ScreenCast and org.gnome.Shell.Introspect
+ * that lists a few fake windows and streams synthetic frames for them
+ * over PipeWire, so that window thumbnails can be tried without GNOME
+ * Shell. Run it in a nested session bus, together with testscreencast.
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <gio/gio.h>
+#include <pipewire/pipewire.h>
+#include <spa/param/video/format-utils.h>
+
+#include "shell-dbus.h"
+
+#define FRAME_INTERVAL_MS 200
+
+typedef struct {
+        uint64_t id;
+        char *title;
+        int width;
+        int height;
+} MockWindow;
+
+typedef struct {
+        char *path;
+        OrgGnomeMutterScreenCastSession *skeleton;
+        GList *streams;
+} MockSession;
+
+typedef struct {
+        char *path;
+        OrgGnomeMutterScreenCastStream *skeleton;
+        MockWindow *window;
+
+        struct pw_stream *pw_stream;
+        struct spa_hook stream_listener;
+        struct spa_source *timer;
+        gboolean announced;
+        unsigned int frame;
+} MockStream;
+
+static GDBusConnection *connection;
+static struct pw_thread_loop *pw_loop;
+static struct pw_core *pw_core;
+static GPtrArray *windows;
+static GHashTable *streams;
+static unsigned int n_sessions;
+static unsigned int n_streams;
+
+static MockWindow *
+find_window (uint64_t id)
+{
+        guint i;
+
+        for (i = 0; i < windows->len; i++) {
+                MockWindow *window = g_ptr_array_index (windows, i);
+
+                if (window->id == id)
+                        return window;
+        }
+
+        return NULL;
+}
+
+/* Vertical bands in a colour picked from the window id, with a bar
+ * that moves down a little every frame.
+ */
+static void
+fill_frame (MockStream *stream,
+            uint8_t *data,
+            int stride)
+{
+        MockWindow *window = stream->window;
+        int bar = (stream->frame * 8) % window->height;
+        int x, y;
+
+        for (y = 0; y < window->height; y++) {
+                uint32_t *row = (uint32_t *) (data + (size_t) y * stride);
+
+                for (x = 0; x < window->width; x++) {
+                        uint8_t shade = (x * 4 / window->width) * 48 + 64;
+
+                        if (y >= bar && y < bar + 16)
+                                row[x] = 0xffffffff;
+                        else
+                                row[x] = 0xff000000 |
+                                         ((window->id * 0x3b) & 0xff) << 16 |
+                                         shade << 8 |
+                                         ((window->id * 0x71) & 0xff);
+                }
+        }
+}
+
+/* Runs in the PipeWire thread, as do the other stream callbacks. */
+static void
+on_stream_process (void *user_data)
+{
+        MockStream *stream = user_data;
+        struct pw_buffer *buffer;
+        struct spa_data *spa_data;
+        int stride = stream->window->width * 4;
+
+        buffer = pw_stream_dequeue_buffer (stream->pw_stream);
+        if (!buffer)
+                return;
+
+        spa_data = &buffer->buffer->datas[0];
+        if (spa_data->data &&
+            spa_data->maxsize >= (uint32_t) stride * stream->window->height) {
+                fill_frame (stream, spa_data->data, stride);
+                spa_data->chunk->offset = 0;
+                spa_data->chunk->stride = stride;
+                spa_data->chunk->size = stride * stream->window->height;
+                stream->frame++;
+        }
+
+        pw_stream_queue_buffer (stream->pw_stream, buffer);
+}
+
+static void
+on_frame_timeout (void *user_data,
+                  uint64_t expirations)
+{
+        MockStream *stream = user_data;
+
+        pw_stream_trigger_process (stream->pw_stream);
+}
+
+static gboolean
+announce_stream (gpointer user_data)
+{
+        g_autofree char *path = user_data;
+        MockStream *stream;
+        uint32_t node_id;
+
+        stream = g_hash_table_lookup (streams, path);
+        if (!stream)
+                return G_SOURCE_REMOVE;
+
+        pw_thread_loop_lock (pw_loop);
+        node_id = pw_stream_get_node_id (stream->pw_stream);
+        pw_thread_loop_unlock (pw_loop);
+
+        org_gnome_mutter_screen_cast_stream_emit_pipewire_stream_added (stream->skeleton,
+                                                                        node_id);
+
+        return G_SOURCE_REMOVE;
+}
+
+static void
+on_stream_state_changed (void *user_data,
+                         enum pw_stream_state old,
+                         enum pw_stream_state state,
+                         const char *error)
+{
+        MockStream *stream = user_data;
+        struct timespec interval = { 0, FRAME_INTERVAL_MS * SPA_NSEC_PER_MSEC };
+
+        if (state == PW_STREAM_STATE_ERROR)
+                g_warning ("Stream %s failed: %s", stream->path, error);
+
+        if (state != PW_STREAM_STATE_PAUSED || stream->announced)
+                return;
+
+        stream->announced = TRUE;
+        stream->timer = pw_loop_add_timer (pw_thread_loop_get_loop (pw_loop),
+                                           on_frame_timeout, stream);
+        pw_loop_update_timer (pw_thread_loop_get_loop (pw_loop),
+                              stream->timer, &interval, &interval, false);
+
+        g_idle_add (announce_stream, g_strdup (stream->path));
+}
+
+static void
+on_stream_param_changed (void *user_data,
+                         uint32_t id,
+                         const struct spa_pod *param)
+{
+        MockStream *stream = user_data;
+        uint8_t params_buffer[1024];
+        struct spa_pod_builder builder =
+                SPA_POD_BUILDER_INIT (params_buffer, sizeof (params_buffer));
+        const struct spa_pod *params[1];
+        int stride = stream->window->width * 4;
+
+        if (param == NULL || id != SPA_PARAM_Format)
+                return;
+
+        params[0] = spa_pod_builder_add_object (&builder,
+                SPA_TYPE_OBJECT_ParamBuffers, SPA_PARAM_Buffers,
+                SPA_PARAM_BUFFERS_buffers, SPA_POD_CHOICE_RANGE_Int (4, 2, 8),
+                SPA_PARAM_BUFFERS_blocks, SPA_POD_Int (1),
+                SPA_PARAM_BUFFERS_size, SPA_POD_Int (stride * stream->window->height),
+                SPA_PARAM_BUFFERS_stride, SPA_POD_Int (stride));
+        pw_stream_update_params (stream->pw_stream, params, 1);
+}
+
+static const struct pw_stream_events stream_events = {
+        PW_VERSION_STREAM_EVENTS,
+        .state_changed = on_stream_state_changed,
+        .param_changed = on_stream_param_changed,
+        .process = on_stream_process,
+};
+
+static void
+start_stream (MockStream *stream)
+{
+        uint8_t params_buffer[1024];
+        struct spa_pod_builder builder =
+                SPA_POD_BUILDER_INIT (params_buffer, sizeof (params_buffer));
+        const struct spa_pod *params[1];
+
+        params[0] = spa_pod_builder_add_object (&builder,
+                SPA_TYPE_OBJECT_Format, SPA_PARAM_EnumFormat,
+                SPA_FORMAT_mediaType, SPA_POD_Id (SPA_MEDIA_TYPE_video),
+                SPA_FORMAT_mediaSubtype, SPA_POD_Id (SPA_MEDIA_SUBTYPE_raw),
+                SPA_FORMAT_VIDEO_format, SPA_POD_Id (SPA_VIDEO_FORMAT_BGRx),
+                SPA_FORMAT_VIDEO_size, SPA_POD_Rectangle (&SPA_RECTANGLE (stream->window->width,
+                                                                          stream->window->height)),
+                SPA_FORMAT_VIDEO_framerate, SPA_POD_Fraction (&SPA_FRACTION (1000 / FRAME_INTERVAL_MS, 1)));
+
+        pw_thread_loop_lock (pw_loop);
+
+        stream->pw_stream = pw_stream_new (pw_core, "mock window",
+                                           pw_properties_new (PW_KEY_MEDIA_CLASS, "Video/Source",
+                                                              NULL));
+        pw_stream_add_listener (stream->pw_stream, &stream->stream_listener,
+                                &stream_events, stream);
+        if (pw_stream_connect (stream->pw_stream,
+                               PW_DIRECTION_OUTPUT,
+                               PW_ID_ANY,
+                               PW_STREAM_FLAG_DRIVER |
+                               PW_STREAM_FLAG_MAP_BUFFERS,
+                               params, 1) < 0)
+                g_warning ("Failed to connect stream %s", stream->path);
+
+        pw_thread_loop_unlock (pw_loop);
+}
+
+static void
+mock_stream_free (MockStream *stream)
+{
+        pw_thread_loop_lock (pw_loop);
+        if (stream->timer)
+                pw_loop_destroy_source (pw_thread_loop_get_loop (pw_loop),
+                                        stream->timer);
+        if (stream->pw_stream) {
+                spa_hook_remove (&stream->stream_listener);
+                pw_stream_destroy (stream->pw_stream);
+        }
+        pw_thread_loop_unlock (pw_loop);
+
+        g_dbus_interface_skeleton_unexport (G_DBUS_INTERFACE_SKELETON (stream->skeleton));
+        g_object_unref (stream->skeleton);
+        g_free (stream->path);
+        g_free (stream);
+}
+
+static void
+mock_session_close (MockSession *session)
+{
+        GList *l;
+
+        for (l = session->streams; l; l = l->next) {
+                MockStream *stream = l->data;
+
+                g_hash_table_remove (streams, stream->path);
+        }
+        g_list_free (session->streams);
+
+        org_gnome_mutter_screen_cast_session_emit_closed (session->skeleton);
+        g_dbus_interface_skeleton_unexport (G_DBUS_INTERFACE_SKELETON (session->skeleton));
+        g_object_unref (session->skeleton);
+        g_free (session->path);
+        g_free (session);
+}
+
+static gboolean
+handle_start (OrgGnomeMutterScreenCastSession *skeleton,
+              GDBusMethodInvocation *invocation,
+              MockSession *session)
+{
+        GList *l;
+
+        for (l = session->streams; l; l = l->next)
+                start_stream (l->data);
+
+        org_gnome_mutter_screen_cast_session_complete_start (skeleton, invocation);
+        return TRUE;
+}
+
+static gboolean
+handle_stop (OrgGnomeMutterScreenCastSession *skeleton,
+             GDBusMethodInvocation *invocation,
+             MockSession *session)
+{
+        org_gnome_mutter_screen_cast_session_complete_stop (skeleton, invocation);
+        mock_session_close (session);
+        return TRUE;
+}
+
+static gboolean
+handle_record_monitor (OrgGnomeMutterScreenCastSession *skeleton,
+                       GDBusMethodInvocation *invocation,
+                       const char *connector,
+                       GVariant *properties,
+                       MockSession *session)
+{
+        g_dbus_method_invocation_return_error (invocation,
+                                               G_DBUS_ERROR,
+                                               G_DBUS_ERROR_NOT_SUPPORTED,
+                                               "Only windows can be recorded");
+        return TRUE;
+}
+
+static gboolean
+handle_record_window (OrgGnomeMutterScreenCastSession *skeleton,
+                      GDBusMethodInvocation *invocation,
+                      GVariant *properties,
+                      MockSession *session)
+{
+        g_autoptr(GError) error = NULL;
+        MockWindow *window = NULL;
+        MockStream *stream;
+        uint64_t window_id;
+
+        if (g_variant_lookup (properties, "window-id", "t", &window_id))
+                window = find_window (window_id);
+        if (!window) {
+                g_dbus_method_invocation_return_error (invocation,
+                                                       G_DBUS_ERROR,
+                                                       G_DBUS_ERROR_INVALID_ARGS,
+                                                       "Unknown window");
+                return TRUE;
+        }
+
+        stream = g_new0 (MockStream, 1);
+        stream->path = g_strdup_printf ("/org/gnome/Mutter/ScreenCast/Stream/u%u",
+                                        ++n_streams);
+        stream->window = window;
+        stream->skeleton = org_gnome_mutter_screen_cast_stream_skeleton_new ();
+        org_gnome_mutter_screen_cast_stream_set_parameters (stream->skeleton,
+                g_variant_new_parsed ("{'size': <(%i, %i)>}",
+                                      window->width, window->height));
+        if (!g_dbus_interface_skeleton_export (G_DBUS_INTERFACE_SKELETON (stream->skeleton),
+                                               connection, stream->path, &error)) {
+                g_dbus_method_invocation_return_gerror (invocation, error);
+                g_object_unref (stream->skeleton);
+                g_free (stream->path);
+                g_free (stream);
+                return TRUE;
+        }
+
+        session->streams = g_list_append (session->streams, stream);
+        g_hash_table_insert (streams, stream->path, stream);
+
+        org_gnome_mutter_screen_cast_session_complete_record_window (skeleton,
+                                                                     invocation,
+                                                                     stream->path);
+        return TRUE;
+}
+
+static gboolean
+handle_create_session (OrgGnomeMutterScreenCast *skeleton,
+                       GDBusMethodInvocation *invocation,
+                       GVariant *properties)
+{
+        g_autoptr(GError) error = NULL;
+        MockSession *session;
+
+        session = g_new0 (MockSession, 1);
+        session->path = g_strdup_printf ("/org/gnome/Mutter/ScreenCast/Session/u%u",
+                                         ++n_sessions);
+        session->skeleton = org_gnome_mutter_screen_cast_session_skeleton_new ();
+        g_signal_connect (session->skeleton, "handle-start",
+                          G_CALLBACK (handle_start), session);
+        g_signal_connect (session->skeleton, "handle-stop",
+                          G_CALLBACK (handle_stop), session);
+        g_signal_connect (session->skeleton, "handle-record-monitor",
+                          G_CALLBACK (handle_record_monitor), session);
+        g_signal_connect (session->skeleton, "handle-record-window",
+                          G_CALLBACK (handle_record_window), session);
+
+        if (!g_dbus_interface_skeleton_export (G_DBUS_INTERFACE_SKELETON (session->skeleton),
+                                               connection, session->path, &error)) {
+                g_dbus_method_invocation_return_gerror (invocation, error);
+                g_object_unref (session->skeleton);
+                g_free (session->path);
+                g_free (session);
+                return TRUE;
+        }
+
+        org_gnome_mutter_screen_cast_complete_create_session (skeleton,
+                                                              invocation,
+                                                              session->path);
+        return TRUE;
+}
+
+static gboolean
+handle_get_windows (OrgGnomeShellIntrospect *skeleton,
+                    GDBusMethodInvocation *invocation)
+{
+        GVariantBuilder builder;
+        guint i;
+
+        g_variant_builder_init (&builder, G_VARIANT_TYPE ("a{ta{sv}}"));
+        for (i = 0; i < windows->len; i++) {
+                MockWindow *window = g_ptr_array_index (windows, i);
+                GVariantBuilder properties;
+
+                g_variant_builder_init (&properties, G_VARIANT_TYPE_VARDICT);
+                g_variant_builder_add (&properties, "{sv}", "title",
+                                       g_variant_new_string (window->title));
+                g_variant_builder_add (&properties, "{sv}", "app-id",
+                                       g_variant_new_string (""));
+                g_variant_builder_add (&properties, "{sv}", "width",
+                                       g_variant_new_uint32 (window->width));
+                g_variant_builder_add (&properties, "{sv}", "height",
+                                       g_variant_new_uint32 (window->height));
+                g_variant_builder_add (&builder, "{ta{sv}}", window->id,
+                                       &properties);
+        }
+
+        org_gnome_shell_introspect_complete_get_windows (skeleton, invocation,
+                                                         g_variant_builder_end (&builder));
+        return TRUE;
+}
+
+static gboolean
+handle_get_running_applications (OrgGnomeShellIntrospect *skeleton,
+                                 GDBusMethodInvocation *invocation)
+{
+        org_gnome_shell_introspect_complete_get_running_applications (skeleton, invocation,
+                g_variant_new_array (G_VARIANT_TYPE ("{sa{sv}}"), NULL, 0));
+        return TRUE;
+}
+
+static void
+on_bus_acquired (GDBusConnection *bus,
+                 const char *name,
+                 gpointer user_data)
+{
+        OrgGnomeMutterScreenCast *screen_cast;
+        OrgGnomeShellIntrospect *introspect;
+        g_autoptr(GError) error = NULL;
+
+        connection = g_object_ref (bus);
+
+        screen_cast = org_gnome_mutter_screen_cast_skeleton_new ();
+        org_gnome_mutter_screen_cast_set_version (screen_cast, 2);
+        g_signal_connect (screen_cast, "handle-create-session",
+                          G_CALLBACK (handle_create_session), NULL);
+        if (!g_dbus_interface_skeleton_export (G_DBUS_INTERFACE_SKELETON (screen_cast),
+                                               connection,
+                                               "/org/gnome/Mutter/ScreenCast",
+                                               &error))
+                g_error ("Failed to export screen cast object: %s", error->message);
+
+        introspect = org_gnome_shell_introspect_skeleton_new ();
+        g_signal_connect (introspect, "handle-get-windows",
+                          G_CALLBACK (handle_get_windows), NULL);
+        g_signal_connect (introspect, "handle-get-running-applications",
+                          G_CALLBACK (handle_get_running_applications), NULL);
+        if (!g_dbus_interface_skeleton_export (G_DBUS_INTERFACE_SKELETON (introspect),
+                                               connection,
+                                               "/org/gnome/Shell/Introspect",
+                                               &error))
+                g_error ("Failed to export introspect object: %s", error->message);
+
+        g_bus_own_name_on_connection (connection, "org.gnome.Shell.Introspect",
+                                      G_BUS_NAME_OWNER_FLAGS_REPLACE,
+                                      NULL, NULL, NULL, NULL);
+}
+
+static void
+on_name_lost (GDBusConnection *bus,
+              const char *name,
+              gpointer user_data)
+{
+        g_printerr ("Lost or failed to acquire %s\n", name);
+        exit (1);
+}
+
+int
+main (int argc, char *argv[])
+{
+        g_autoptr(GOptionContext) context = NULL;
+        g_autoptr(GError) error = NULL;
+        g_autoptr(GMainLoop) loop = NULL;
+        struct pw_context *pw_context;
+        int n_windows = 5;
+        int i;
+        GOptionEntry entries[] = {
+          { "windows", 0, 0, G_OPTION_ARG_INT, &n_windows, "Number of windows", "N" },
+          { NULL, }
+        };
+
+        context = g_option_context_new ("- mock GNOME screen cast service");
+        g_option_context_add_main_entries (context, entries, NULL);
+        if (!g_option_context_parse (context, &argc, &argv, &error)) {
+                g_printerr ("%s\n", error->message);
+                return 1;
+        }
+
+        windows = g_ptr_array_new ();
+        for (i = 0; i < n_windows; i++) {
+                MockWindow *window = g_new0 (MockWindow, 1);
+
+                window->id = 1000 + i;
+                window->title = g_strdup_printf ("Mock window %d", i + 1);
+                window->width = 640 + (i % 4) * 320;
+                window->height = 480 + (i % 3) * 120;
+                g_ptr_array_add (windows, window);
+        }
+        streams = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                         NULL, (GDestroyNotify) mock_stream_free);
+
+        pw_init (&argc, &argv);
+        pw_loop = pw_thread_loop_new ("mock-screen-cast", NULL);
+        pw_context = pw_context_new (pw_thread_loop_get_loop (pw_loop), NULL, 0);
+        if (pw_thread_loop_start (pw_loop) < 0) {
+                g_printerr ("Failed to start the PipeWire loop\n");
+                return 1;
+        }
+        pw_thread_loop_lock (pw_loop);
+        pw_core = pw_context_connect (pw_context, NULL, 0);
+        pw_thread_loop_unlock (pw_loop);
+        if (!pw_core) {
+                g_printerr ("Failed to connect to PipeWire\n");
+                return 1;
+        }
+
+        g_bus_own_name (G_BUS_TYPE_SESSION,
+                        "org.gnome.Mutter.ScreenCast",
+                        G_BUS_NAME_OWNER_FLAGS_REPLACE,
+                        on_bus_acquired,
+                        NULL,
+                        on_name_lost,
+                        NULL, NULL);
+
+        loop = g_main_loop_new (NULL, FALSE);
+        g_main_loop_run (loop);
+
+        return 0;
+}
@@ -222,6 +222,41 @@ has_unprefixed_action (GVariant *notification)
   return FALSE;
 }
 
+static void
+gtk_notifications_proxy_created (GObject *source_object,
+                                 GAsyncResult *result,
+                                 gpointer data)
+{
+  g_autoptr(GError) error = NULL;
+  OrgGtkNotifications *proxy;
+
+  proxy = org_gtk_notifications_proxy_new_finish (result, &error);
+  if (proxy == NULL)
+    {
+      g_warning ("Failed to create notifications proxy: %s", error->message);
+      return;
+    }
+
+  if (gtk_notifications == NULL)
+    gtk_notifications = proxy;
+  else
+    g_object_unref (proxy);
+}
+
+static OrgGtkNotifications *
+get_gtk_notifications (GDBusConnection *bus)
+{
+  if (gtk_notifications == NULL)
+    gtk_notifications = org_gtk_notifications_proxy_new_sync (bus,
+                                                              G_DBUS_PROXY_FLAGS_DO_NOT_AUTO_START,
+                                                              "org.gtk.Notifications",
+                                                              "/org/gtk/Notifications",
+                                                              NULL,
+                                                              NULL);
+
+  return gtk_notifications;
+}
+
 static gboolean
 handle_add_notification (XdpImplNotification *object,
                          GDBusMethodInvocation *invocation,
@@ -229,8 +264,12 @@ handle_add_notification (XdpImplNotification *object,
                          const gchar *arg_id,
                          GVariant *arg_notification)
 {
-  if (gtk_notifications == NULL ||
-      g_dbus_proxy_get_name_owner (G_DBUS_PROXY (gtk_notifications)) == NULL ||
+  OrgGtkNotifications *proxy;
+
+  proxy = get_gtk_notifications (g_dbus_method_invocation_get_connection (invocation));
+
+  if (proxy == NULL ||
+      g_dbus_proxy_get_name_owner (G_DBUS_PROXY (proxy)) == NULL ||
       has_unprefixed_action (arg_notification))
     handle_add_notification_fdo (object, invocation, arg_app_id, arg_id, arg_notification);
   else
@@ -256,12 +295,14 @@ notification_init (GDBusConnection *bus,
 {
   GDBusInterfaceSkeleton *helper;
 
-  gtk_notifications = org_gtk_notifications_proxy_new_sync (bus,
-                                                            G_DBUS_PROXY_FLAGS_DO_NOT_AUTO_START,
-                                                            "org.gtk.Notifications",
-                                                            "/org/gtk/Notifications",
-                                                            NULL,
-                                                            NULL);
+  /* A request that comes in before the proxy is ready creates it */
+  org_gtk_notifications_proxy_new (bus,
+                                   G_DBUS_PROXY_FLAGS_DO_NOT_AUTO_START,
+                                   "org.gtk.Notifications",
+                                   "/org/gtk/Notifications",
+                                   NULL,
+                                   gtk_notifications_proxy_created,
+                                   NULL);
 
   helper = G_DBUS_INTERFACE_SKELETON (xdp_impl_notification_skeleton_new ());
 
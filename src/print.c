@@ -22,7 +22,15 @@
 
 #include "config.h"
 
+#include <errno.h>
 #include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#ifdef __linux__
+#include <linux/fs.h>
+#endif
 
 #include <gtk/gtk.h>
 #include <gtk/gtkunixprint.h>
@@ -41,24 +49,74 @@
 
 #include "gtkbackports.h"
 
+/* Print params are kept for PRINT_PARAMS_TIMEOUT seconds after
+ * PreparePrint. Rather than arming a timeout per token, they are
+ * placed in a timer wheel that is advanced by a single timeout
+ * every PRINT_PARAMS_TICK seconds, while there are any params.
+ */
+#define PRINT_PARAMS_TIMEOUT 300
+#define PRINT_PARAMS_TICK 10
+#define PRINT_PARAMS_WHEEL_SIZE (PRINT_PARAMS_TIMEOUT / PRINT_PARAMS_TICK + 1)
+#define PRINT_PARAMS_MAX_PER_APP 16
+#define PRINT_PARAMS_MAX_SLOTS 0xffff
+
 typedef struct {
   char *app_id;
   GtkPageSetup *page_setup;
   GtkPrintSettings *settings;
   GtkPrinter *printer;
-  guint timeout_id;
   guint32 token;
   gboolean preview;
+
+  GList wheel_link;
+  guint wheel_pos;
+  GList app_link;
 } PrintParams;
 
-static GHashTable *print_params;
+/* Tokens are dense: the low 16 bits are the slot index plus one, the
+ * high 16 bits are the generation of the slot, so that a stale token
+ * does not match params that reuse its slot.
+ */
+typedef struct {
+  PrintParams *params;
+  guint16 generation;
+} PrintParamsSlot;
+
+static GArray *params_slots;
+static GArray *free_slots;
+static GHashTable *params_by_app;
+static GQueue params_wheel[PRINT_PARAMS_WHEEL_SIZE];
+static guint wheel_pos;
+static guint wheel_timeout_id;
+static guint n_print_params;
 
 static void
 print_params_free (gpointer data)
 {
   PrintParams *params = data;
+  PrintParamsSlot *slot;
+  guint index;
+  GQueue *queue;
+
+  index = (params->token & 0xffff) - 1;
+  slot = &g_array_index (params_slots, PrintParamsSlot, index);
+  slot->params = NULL;
+  slot->generation++;
+  g_array_append_val (free_slots, index);
+
+  g_queue_unlink (&params_wheel[params->wheel_pos], &params->wheel_link);
 
-  g_hash_table_remove (print_params, GUINT_TO_POINTER (params->token));
+  queue = g_hash_table_lookup (params_by_app, params->app_id);
+  g_queue_unlink (queue, &params->app_link);
+  if (g_queue_is_empty (queue))
+    g_hash_table_remove (params_by_app, params->app_id);
+
+  n_print_params--;
+  if (n_print_params == 0 && wheel_timeout_id != 0)
+    {
+      g_source_remove (wheel_timeout_id);
+      wheel_timeout_id = 0;
+    }
 
   g_free (params->app_id);
   g_object_unref (params->page_setup);
@@ -71,18 +129,82 @@ print_params_free (gpointer data)
 static void
 ensure_print_params (void)
 {
-  if (print_params)
+  if (params_slots)
     return;
 
-  print_params = g_hash_table_new (g_direct_hash, g_direct_equal);
+  params_slots = g_array_new (FALSE, TRUE, sizeof (PrintParamsSlot));
+  free_slots = g_array_new (FALSE, FALSE, sizeof (guint));
+  params_by_app = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                         g_free, (GDestroyNotify)g_queue_free);
 }
 
 static gboolean
-print_params_timeout (gpointer data)
+print_params_tick (gpointer data)
 {
-  print_params_free (data);
-  g_debug ("Removing print params, now %d", g_hash_table_size (print_params));
-  return G_SOURCE_REMOVE;
+  GQueue *expired;
+  guint n_expired = 0;
+
+  wheel_pos = (wheel_pos + 1) % PRINT_PARAMS_WHEEL_SIZE;
+  expired = &params_wheel[wheel_pos];
+
+  while (!g_queue_is_empty (expired) && wheel_timeout_id != 0)
+    {
+      print_params_free (g_queue_peek_head (expired));
+      n_expired++;
+    }
+
+  if (n_expired > 0)
+    g_debug ("Removing %u print params, now %u", n_expired, n_print_params);
+
+  if (wheel_timeout_id == 0)
+    return G_SOURCE_REMOVE;
+
+  return G_SOURCE_CONTINUE;
+}
+
+static guint32
+allocate_token (PrintParams *params)
+{
+  PrintParamsSlot *slot;
+  guint index;
+
+  if (free_slots->len > 0)
+    {
+      index = g_array_index (free_slots, guint, free_slots->len - 1);
+      g_array_set_size (free_slots, free_slots->len - 1);
+    }
+  else if (params_slots->len < PRINT_PARAMS_MAX_SLOTS)
+    {
+      index = params_slots->len;
+      g_array_set_size (params_slots, params_slots->len + 1);
+    }
+  else
+    {
+      return 0;
+    }
+
+  slot = &g_array_index (params_slots, PrintParamsSlot, index);
+  slot->params = params;
+
+  return ((guint32)slot->generation << 16) | (index + 1);
+}
+
+static void
+evict_oldest_print_params (void)
+{
+  guint i;
+
+  /* The bucket after the current position is the next one to expire */
+  for (i = 1; i <= PRINT_PARAMS_WHEEL_SIZE; i++)
+    {
+      GQueue *queue = &params_wheel[(wheel_pos + i) % PRINT_PARAMS_WHEEL_SIZE];
+
+      if (!g_queue_is_empty (queue))
+        {
+          print_params_free (g_queue_peek_head (queue));
+          return;
+        }
+    }
 }
 
 static PrintParams *
@@ -93,7 +215,7 @@ print_params_new (const char *app_id,
                   GtkPrinter *printer)
 {
   PrintParams *params;
-  guint32 r;
+  GQueue *queue;
 
   ensure_print_params ();
 
@@ -104,18 +226,40 @@ print_params_new (const char *app_id,
   params->printer = g_object_ref (printer);
   params->preview = preview;
 
-  do {
-    r = g_random_int ();
-  } while (r == 0 || g_hash_table_lookup (print_params, GUINT_TO_POINTER (r)) != NULL);
+  params->token = allocate_token (params);
+  if (params->token == 0)
+    {
+      evict_oldest_print_params ();
+      params->token = allocate_token (params);
+    }
+
+  n_print_params++;
 
-  params->token = r;
-  g_hash_table_insert (print_params, GUINT_TO_POINTER (r), params);
+  params->wheel_link.data = params;
+  params->wheel_pos = (wheel_pos + PRINT_PARAMS_WHEEL_SIZE - 1) % PRINT_PARAMS_WHEEL_SIZE;
+  g_queue_push_tail_link (&params_wheel[params->wheel_pos], &params->wheel_link);
 
-  g_debug ("Remembering print params for %s, token %u, now %d",
-           params->app_id, params->token,
-           g_hash_table_size (print_params));
+  if (wheel_timeout_id == 0)
+    wheel_timeout_id = g_timeout_add_seconds (PRINT_PARAMS_TICK, print_params_tick, NULL);
 
-  params->timeout_id = g_timeout_add_seconds (300, print_params_timeout, params);
+  queue = g_hash_table_lookup (params_by_app, app_id);
+  if (queue == NULL)
+    {
+      queue = g_queue_new ();
+      g_hash_table_insert (params_by_app, g_strdup (app_id), queue);
+    }
+
+  params->app_link.data = params;
+  g_queue_push_tail_link (queue, &params->app_link);
+
+  /* Apps that never use their tokens should not be able to pile up
+   * params, so drop the least recently prepared ones.
+   */
+  while (g_queue_get_length (queue) > PRINT_PARAMS_MAX_PER_APP)
+    print_params_free (g_queue_peek_head (queue));
+
+  g_debug ("Remembering print params for %s, token %u, now %u",
+           params->app_id, params->token, n_print_params);
 
   return params;
 }
@@ -124,19 +268,24 @@ static PrintParams *
 get_print_params (const char *app_id,
                   guint32 token)
 {
-  PrintParams *params;
+  PrintParamsSlot *slot;
+  guint index;
 
-  params = (PrintParams *)g_hash_table_lookup (print_params, GUINT_TO_POINTER (token));
-  if (params == NULL)
+  if (params_slots == NULL || (token & 0xffff) == 0)
     return NULL;
 
-  if (strcmp (params->app_id, app_id) != 0)
+  index = (token & 0xffff) - 1;
+  if (index >= params_slots->len)
     return NULL;
 
-  g_source_remove (params->timeout_id);
-  g_hash_table_remove (print_params, GUINT_TO_POINTER (token));
+  slot = &g_array_index (params_slots, PrintParamsSlot, index);
+  if (slot->params == NULL || slot->params->token != token)
+    return NULL;
 
-  return params;
+  if (strcmp (slot->params->app_id, app_id) != 0)
+    return NULL;
+
+  return slot->params;
 }
 
 typedef struct {
@@ -159,9 +308,10 @@ print_dialog_handle_free (gpointer data)
   PrintDialogHandle *handle = data;
 
   g_clear_object (&handle->external_parent);
-  g_object_unref (handle->request);
-  g_object_unref (handle->dialog);
-  close (handle->fd);
+  g_clear_object (&handle->request);
+  g_clear_object (&handle->dialog);
+  if (handle->fd != -1)
+    close (handle->fd);
 
   g_free (handle);
 }
@@ -169,23 +319,80 @@ print_dialog_handle_free (gpointer data)
 static void
 print_dialog_handle_close (PrintDialogHandle *handle)
 {
-  gtk_widget_destroy (handle->dialog);
+  if (handle->dialog)
+    gtk_widget_destroy (handle->dialog);
   print_dialog_handle_free (handle);
 }
 
+static const char *
+get_previewer (void)
+{
+  static gsize initialized = 0;
+  static char *previewer = NULL;
+
+  if (g_once_init_enter (&initialized))
+    {
+      previewer = g_find_program_in_path ("evince-previewer");
+      if (previewer == NULL)
+        g_warning ("evince-previewer not found, disabling print preview");
+
+      g_once_init_leave (&initialized, 1);
+    }
+
+  return previewer;
+}
+
 static gboolean
 can_preview (void)
 {
-  g_autofree char *path = NULL;
+  return get_previewer () != NULL;
+}
 
-  path = g_find_program_in_path ("evince-previewer");
+static int
+create_settings_fd (const char *data,
+                    gsize data_len,
+                    char **filename,
+                    GError **error)
+{
+  int fd;
 
-  if (path)
-    return TRUE;
+#ifdef HAVE_MEMFD_CREATE
+  fd = memfd_create ("print-settings", MFD_CLOEXEC);
+  if (fd != -1)
+    *filename = NULL;
+  else
+#endif
+  fd = g_file_open_tmp ("settingsXXXXXX.ini", filename, error);
 
-  g_warning ("evince-previewer not found, disabling print preview");
+  if (fd == -1)
+    return -1;
 
-  return FALSE;
+  while (data_len > 0)
+    {
+      gssize written = write (fd, data, data_len);
+
+      if (written < 0 && errno == EINTR)
+        continue;
+
+      if (written < 0)
+        {
+          int errsv = errno;
+          g_set_error (error, G_IO_ERROR, g_io_error_from_errno (errsv),
+                       "Failed to write print settings: %s", g_strerror (errsv));
+          close (fd);
+          if (*filename)
+            unlink (*filename);
+          g_clear_pointer (filename, g_free);
+          return -1;
+        }
+
+      data += written;
+      data_len -= written;
+    }
+
+  lseek (fd, 0, SEEK_SET);
+
+  return fd;
 }
 
 static gboolean
@@ -195,19 +402,28 @@ launch_preview (const char *filename,
                 GtkPageSetup *page_setup,
                 GError **error)
 {
-  g_autofree char *cmd = NULL;
-  g_autoptr(GAppInfo) appinfo = NULL;
+  g_autoptr(GSubprocessLauncher) launcher = NULL;
+  g_autoptr(GSubprocess) subprocess = NULL;
   g_autoptr(GAppLaunchContext) context = NULL;
-  gboolean retval = FALSE;
+  g_autoptr(GAppInfo) appinfo = NULL;
+  g_auto(GStrv) envp = NULL;
+  g_autofree char *display = NULL;
+  g_autofree char *startup_id = NULL;
   g_autoptr(GKeyFile) keyfile = NULL;
   g_autofree char *data = NULL;
   gsize data_len;
   g_autofree char *settings_filename = NULL;
+  const char *settings_path;
+  const char *argv[7];
   int fd;
+  int i = 0;
 
-  fd = g_file_open_tmp ("settingsXXXXXX.ini", &settings_filename, error);
-  if (fd == -1)
-    goto out;
+  if (!can_preview ())
+    {
+      g_set_error (error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND,
+                   "No print previewer available");
+      return FALSE;
+    }
 
   keyfile = g_key_file_new ();
 
@@ -220,98 +436,472 @@ launch_preview (const char *filename,
   g_key_file_set_string (keyfile, "Print Job", "title", title);
 
   data = g_key_file_to_data (keyfile, &data_len, NULL);
-  if (data)
-    g_file_set_contents (settings_filename, data, data_len, NULL);
 
-  cmd = g_strdup_printf ("evince-previewer --unlink-tempfile --print-settings %s %s", settings_filename, filename);
+  fd = create_settings_fd (data, data_len, &settings_filename, error);
+  if (fd == -1)
+    return FALSE;
+
+  launcher = g_subprocess_launcher_new (G_SUBPROCESS_FLAGS_NONE);
 
-  g_debug ("launching %s", cmd);
+  /* Spawn the previewer ourselves to pass it the settings fd, but
+   * keep the environment and startup notification that launching
+   * it as an app would give it.
+   */
+  context = G_APP_LAUNCH_CONTEXT (gdk_display_get_app_launch_context (gdk_display_get_default ()));
+  envp = g_app_launch_context_get_environment (context);
+  g_subprocess_launcher_set_environ (launcher, envp);
 
-  appinfo = g_app_info_create_from_commandline (cmd,
+  appinfo = g_app_info_create_from_commandline (get_previewer (),
                                                 "Print Preview",
-                                                G_APP_INFO_CREATE_NONE,
-                                                error);
-  if (!appinfo)
-    goto out;
+                                                G_APP_INFO_CREATE_SUPPORTS_STARTUP_NOTIFICATION,
+                                                NULL);
+  if (appinfo)
+    {
+      display = g_app_launch_context_get_display (context, appinfo, NULL);
+      if (display)
+        g_subprocess_launcher_setenv (launcher, "DISPLAY", display, TRUE);
+
+      startup_id = g_app_launch_context_get_startup_notify_id (context, appinfo, NULL);
+      if (startup_id)
+        g_subprocess_launcher_setenv (launcher, "DESKTOP_STARTUP_ID", startup_id, TRUE);
+    }
+
+  if (settings_filename)
+    {
+      settings_path = settings_filename;
+      close (fd);
+    }
+  else
+    {
+      /* Hand the memfd to the previewer instead of going through a
+       * file on disk.
+       */
+      settings_path = "/proc/self/fd/3";
+      g_subprocess_launcher_take_fd (launcher, fd, 3);
+    }
+
+  argv[i++] = get_previewer ();
+  argv[i++] = "--unlink-tempfile";
+  argv[i++] = "--print-settings";
+  argv[i++] = settings_path;
+  argv[i++] = filename;
+  argv[i++] = NULL;
+
+  g_debug ("launching %s --print-settings %s %s", argv[0], settings_path, filename);
+
+  subprocess = g_subprocess_launcher_spawnv (launcher, argv, error);
+  if (!subprocess && startup_id)
+    g_app_launch_context_launch_failed (context, startup_id);
+
+  return subprocess != NULL;
+}
+
+typedef struct {
+  char *app_id;
+  char *title;
+  char *filename;
+  GtkPrintJob *job;
+  GtkPrintSettings *settings;
+  GtkPageSetup *page_setup;
+  int job_fd;
+
+  GInputStream *istream;
+  GOutputStream *ostream;
+  guchar *buffer;
+  guint64 bytes;
+  guint64 last_progress;
+
+  gint64 start_time;
+  gint64 spooled_time;
+  gint64 submitted_time;
+} PrintSpool;
+
+#define SPOOL_CHUNK_SIZE (256 * 1024)
+#define SPOOL_PROGRESS_INTERVAL (16 * 1024 * 1024)
+
+static void
+print_spool_free (gpointer data)
+{
+  PrintSpool *spool = data;
+
+  if (spool->filename)
+    unlink (spool->filename);
+
+  if (spool->job)
+    g_signal_handlers_disconnect_by_data (spool->job, spool);
+
+  if (spool->job_fd != -1)
+    close (spool->job_fd);
+
+  g_free (spool->app_id);
+  g_free (spool->title);
+  g_free (spool->filename);
+  g_clear_object (&spool->job);
+  g_clear_object (&spool->settings);
+  g_clear_object (&spool->page_setup);
+  g_clear_object (&spool->istream);
+  g_clear_object (&spool->ostream);
+  g_free (spool->buffer);
+
+  g_free (spool);
+}
+
+static void
+print_spool_log_timing (PrintSpool *spool)
+{
+  g_debug ("Print job from %s: %" G_GUINT64_FORMAT " bytes, spooled in %.1f ms, submitted in %.1f ms",
+           spool->app_id,
+           spool->bytes,
+           (spool->spooled_time - spool->start_time) / 1000.0,
+           (spool->submitted_time - spool->spooled_time) / 1000.0);
+}
+
+static void
+print_job_status_changed (GtkPrintJob *job,
+                          PrintSpool  *spool)
+{
+  g_debug ("Print job from %s: status %d", spool->app_id, gtk_print_job_get_status (job));
+}
+
+static void
+print_job_complete (GtkPrintJob  *job,
+                    gpointer      data,
+                    const GError *error)
+{
+  GTask *task = data;
+  PrintSpool *spool = g_task_get_task_data (task);
+
+  spool->submitted_time = g_get_monotonic_time ();
+  print_spool_log_timing (spool);
+
+  if (error)
+    g_task_return_error (task, g_error_copy (error));
+  else
+    g_task_return_boolean (task, TRUE);
+
+  g_object_unref (task);
+}
+
+static void
+print_spool_send (GTask *task)
+{
+  PrintSpool *spool = g_task_get_task_data (task);
+  GError *error = NULL;
+
+  spool->spooled_time = g_get_monotonic_time ();
+
+  g_signal_connect (spool->job, "status-changed",
+                    G_CALLBACK (print_job_status_changed), spool);
+
+  /* gtk_print_job_send() always calls the completion function,
+   * which takes over our reference on the task.
+   */
+  if (spool->filename &&
+      !gtk_print_job_set_source_file (spool->job, spool->filename, &error))
+    {
+      g_task_return_error (task, error);
+      g_object_unref (task);
+      return;
+    }
+
+  gtk_print_job_send (spool->job, print_job_complete, task, NULL);
+}
+
+static void
+print_spool_done (GTask *task)
+{
+  PrintSpool *spool = g_task_get_task_data (task);
+  GError *error = NULL;
+
+  g_debug ("Spooled %" G_GUINT64_FORMAT " bytes to %s", spool->bytes, spool->filename);
+
+  if (spool->job)
+    {
+      /* The file will be removed when the GtkPrintJob closes it (once the
+       * job is complete).
+       */
+      print_spool_send (task);
+      return;
+    }
+
+  spool->spooled_time = g_get_monotonic_time ();
+
+  if (!launch_preview (spool->filename, spool->title, spool->settings, spool->page_setup, &error))
+    g_task_return_error (task, error);
+  else
+    g_task_return_boolean (task, TRUE);
 
-  context = (GAppLaunchContext *)gdk_display_get_app_launch_context (gdk_display_get_default ());
-  retval = g_app_info_launch (appinfo, NULL, G_APP_LAUNCH_CONTEXT (context), error);
+  spool->submitted_time = g_get_monotonic_time ();
+  print_spool_log_timing (spool);
 
-out:
-  if (fd > 0)
-    close (fd);
+  g_object_unref (task);
+}
+
+static void print_spool_read_cb (GObject      *source,
+                                 GAsyncResult *result,
+                                 gpointer      data);
+
+static void
+print_spool_write_cb (GObject      *source,
+                      GAsyncResult *result,
+                      gpointer      data)
+{
+  GTask *task = data;
+  PrintSpool *spool = g_task_get_task_data (task);
+  GError *error = NULL;
+  gsize written;
+
+  if (!g_output_stream_write_all_finish (G_OUTPUT_STREAM (source), result, &written, &error))
+    {
+      g_task_return_error (task, error);
+      g_object_unref (task);
+      return;
+    }
+
+  spool->bytes += written;
+  if (spool->bytes - spool->last_progress >= SPOOL_PROGRESS_INTERVAL)
+    {
+      g_debug ("Spooling %s: %" G_GUINT64_FORMAT " bytes", spool->filename, spool->bytes);
+      spool->last_progress = spool->bytes;
+    }
 
-  return retval;
+  g_input_stream_read_async (spool->istream,
+                             spool->buffer,
+                             SPOOL_CHUNK_SIZE,
+                             G_PRIORITY_LOW,
+                             NULL,
+                             print_spool_read_cb,
+                             task);
+}
+
+static void
+print_spool_read_cb (GObject      *source,
+                     GAsyncResult *result,
+                     gpointer      data)
+{
+  GTask *task = data;
+  PrintSpool *spool = g_task_get_task_data (task);
+  GError *error = NULL;
+  gssize n_read;
+
+  n_read = g_input_stream_read_finish (G_INPUT_STREAM (source), result, &error);
+  if (n_read < 0)
+    {
+      g_task_return_error (task, error);
+      g_object_unref (task);
+      return;
+    }
+
+  if (n_read == 0)
+    {
+      if (!g_output_stream_close (spool->ostream, NULL, &error))
+        {
+          g_task_return_error (task, error);
+          g_object_unref (task);
+          return;
+        }
+
+      print_spool_done (task);
+      return;
+    }
+
+  g_output_stream_write_all_async (spool->ostream,
+                                   spool->buffer,
+                                   n_read,
+                                   G_PRIORITY_LOW,
+                                   NULL,
+                                   print_spool_write_cb,
+                                   task);
 }
 
 static gboolean
+clone_file (int src_fd,
+            int dest_fd)
+{
+#ifdef FICLONE
+  /* On reflink-capable filesystems this shares the extents instead of
+   * copying any data.
+   */
+  return ioctl (dest_fd, FICLONE, src_fd) == 0;
+#else
+  return FALSE;
+#endif
+}
+
+static guint64
+get_file_size (int fd)
+{
+  struct stat buf;
+
+  if (fstat (fd, &buf) == 0 && S_ISREG (buf.st_mode))
+    return buf.st_size;
+
+  return 0;
+}
+
+static void
 print_file (int fd,
             const char *app_id,
             gboolean preview,
             GtkPrinter *printer,
             GtkPrintSettings *settings,
             GtkPageSetup *page_setup,
-            GError **error)
+            GAsyncReadyCallback callback,
+            gpointer data)
 {
-  g_autoptr (GtkPrintJob) job = NULL;
-  g_autofree char *title = NULL;
-  g_autofree char *filename = NULL;
-  g_autoptr(GUnixInputStream) istream = NULL;
-  g_autoptr(GUnixOutputStream) ostream = NULL;
+  GTask *task;
+  PrintSpool *spool;
+  GError *error = NULL;
   int fd2;
+  int spool_fd;
 
-  title = g_strdup_printf ("Document from %s", app_id);
+  task = g_task_new (NULL, NULL, callback, data);
+
+  spool = g_new0 (PrintSpool, 1);
+  spool->app_id = g_strdup (app_id);
+  spool->title = g_strdup_printf ("Document from %s", app_id);
+  spool->settings = settings ? g_object_ref (settings) : NULL;
+  spool->page_setup = page_setup ? g_object_ref (page_setup) : NULL;
+  spool->job_fd = -1;
+  spool->start_time = g_get_monotonic_time ();
+  g_task_set_task_data (task, spool, print_spool_free);
 
   if (!preview)
-    job = gtk_print_job_new (title, printer, settings, page_setup);
+    spool->job = gtk_print_job_new (spool->title, printer, settings, page_setup);
 
 #if GTK_CHECK_VERSION (3, 22, 0)
-  if (job && !gtk_print_job_set_source_fd (job, fd, error))
-    return FALSE;
+  if (spool->job)
+    {
+      /* Let the job read straight from the client fd, instead of
+       * spooling a copy of the document first.
+       */
+      spool->job_fd = dup (fd);
+      if (spool->job_fd == -1)
+        {
+          int errsv = errno;
+          g_task_return_new_error (task, G_IO_ERROR, g_io_error_from_errno (errsv),
+                                   "Failed to duplicate fd: %s", g_strerror (errsv));
+          g_object_unref (task);
+          return;
+        }
+
+      if (!gtk_print_job_set_source_fd (spool->job, spool->job_fd, &error))
+        {
+          g_task_return_error (task, error);
+          g_object_unref (task);
+          return;
+        }
+
+      spool->bytes = get_file_size (fd);
+      print_spool_send (task);
+      return;
+    }
 #endif
 
-  istream = (GUnixInputStream *)g_unix_input_stream_new (fd, FALSE);
+  if ((fd2 = g_file_open_tmp (PACKAGE_NAME "XXXXXX", &spool->filename, &error)) == -1)
+    {
+      g_task_return_error (task, error);
+      g_object_unref (task);
+      return;
+    }
 
-  if ((fd2 = g_file_open_tmp (PACKAGE_NAME "XXXXXX", &filename, error)) == -1)
-    return FALSE;
+  if (clone_file (fd, fd2))
+    {
+      close (fd2);
+      spool->bytes = get_file_size (fd);
+      print_spool_done (task);
+      return;
+    }
 
-  ostream = (GUnixOutputStream *)g_unix_output_stream_new (fd2, TRUE);
+  spool_fd = dup (fd);
+  if (spool_fd == -1)
+    {
+      int errsv = errno;
+      close (fd2);
+      g_task_return_new_error (task, G_IO_ERROR, g_io_error_from_errno (errsv),
+                               "Failed to duplicate fd: %s", g_strerror (errsv));
+      g_object_unref (task);
+      return;
+    }
 
-  if (g_output_stream_splice (G_OUTPUT_STREAM (ostream),
-                              G_INPUT_STREAM (istream),
-                              G_OUTPUT_STREAM_SPLICE_NONE,
-                              NULL,
-                              error) == -1)
-    return FALSE;
+  /* Copy the remaining data without blocking the main loop; the spool
+   * owns its own fds, so the caller may close the client fd right away.
+   */
+  spool->istream = g_unix_input_stream_new (spool_fd, TRUE);
+  spool->ostream = g_unix_output_stream_new (fd2, TRUE);
+  spool->buffer = g_malloc (SPOOL_CHUNK_SIZE);
+
+  g_input_stream_read_async (spool->istream,
+                             spool->buffer,
+                             SPOOL_CHUNK_SIZE,
+                             G_PRIORITY_LOW,
+                             NULL,
+                             print_spool_read_cb,
+                             task);
+}
 
-  if (job)
-    {
-      if (!gtk_print_job_set_source_file (job, filename, error))
-        return FALSE;
+static gboolean
+print_file_finish (GAsyncResult *result,
+                   GError **error)
+{
+  return g_task_propagate_boolean (G_TASK (result), error);
+}
 
-      gtk_print_job_send (job, NULL, NULL, NULL);
+static void
+send_print_response (PrintDialogHandle *handle,
+                     GError *error)
+{
+  if (handle->request && handle->request->exported)
+    request_unexport (handle->request);
+
+  if (error)
+    {
+      g_dbus_method_invocation_take_error (handle->invocation, error);
     }
   else
     {
-      if (!launch_preview (filename, title, settings, page_setup, error))
-        return FALSE;
+      GVariantBuilder opt_builder;
+
+      g_variant_builder_init (&opt_builder, G_VARIANT_TYPE_VARDICT);
+      xdp_impl_print_complete_print (handle->impl,
+                                     handle->invocation,
+                                     NULL,
+                                     handle->response,
+                                     g_variant_builder_end (&opt_builder));
     }
 
-  /* The file will be removed when the GtkPrintJob closes it (once the job is
-   * complete).
+  print_dialog_handle_close (handle);
+}
+
+static void
+print_file_done (GObject *source,
+                 GAsyncResult *result,
+                 gpointer data)
+{
+  PrintDialogHandle *handle = data;
+  GError *error = NULL;
+
+  /* Errors are returned as D-Bus errors, the response only matters
+   * on success.
    */
-  unlink (filename);
+  if (!print_file_finish (result, &error))
+    g_warning ("Failed to print: %s", error->message);
+  else
+    handle->response = 0;
 
-  return TRUE;
+  send_print_response (handle, error);
 }
 
+static gboolean handle_close (XdpImplRequest *object,
+                              GDBusMethodInvocation *invocation,
+                              PrintDialogHandle *handle);
+
 static void
 handle_print_response (GtkDialog *dialog,
                        gint response,
                        gpointer data)
 {
   PrintDialogHandle *handle = data;
-  g_autoptr(GError) error = NULL;
   gboolean preview = FALSE;
 
   switch (response)
@@ -341,42 +931,27 @@ handle_print_response (GtkDialog *dialog,
         settings = gtk_print_unix_dialog_get_settings (GTK_PRINT_UNIX_DIALOG (handle->dialog));
         page_setup = gtk_print_unix_dialog_get_page_setup (GTK_PRINT_UNIX_DIALOG (handle->dialog));
 
-        if (!print_file (handle->fd,
-                         handle->request->app_id,
-                         preview,
-                         printer,
-                         settings,
-                         page_setup,
-                         &error))
-          handle->response = 2;
-        else
-          handle->response = 0;
+        /* The job now runs to completion regardless of the request;
+         * the response is sent once it has been submitted.
+         */
+        g_signal_handlers_disconnect_by_func (handle->request, handle_close, handle);
+        gtk_widget_hide (handle->dialog);
+
+        print_file (handle->fd,
+                    handle->request->app_id,
+                    preview,
+                    printer,
+                    settings,
+                    page_setup,
+                    print_file_done,
+                    handle);
 
         g_object_unref (settings);
       }
-      break;
-    }
-
-  if (handle->request->exported)
-    request_unexport (handle->request);
-
-  if (error)
-    {
-      g_dbus_method_invocation_take_error (handle->invocation, error);
-    }
-  else
-    {
-      GVariantBuilder opt_builder;
-
-      g_variant_builder_init (&opt_builder, G_VARIANT_TYPE_VARDICT);
-      xdp_impl_print_complete_print (handle->impl,
-                                     handle->invocation,
-                                     NULL,
-                                     handle->response,
-                                     g_variant_builder_end (&opt_builder));
+      return;
     }
 
-  print_dialog_handle_close (handle);
+  send_print_response (handle, NULL);
 }
 
 static gboolean
@@ -392,16 +967,100 @@ handle_close (XdpImplRequest *object,
                                  NULL,
                                  2,
                                  g_variant_builder_end (&opt_builder));
-  print_dialog_handle_close (handle);
 
   if (handle->request->exported)
     request_unexport (handle->request);
 
-  xdp_impl_request_complete_close (object, invocation);
+  print_dialog_handle_close (handle);
+
+  if (invocation)
+    xdp_impl_request_complete_close (object, invocation);
 
   return TRUE;
 }
 
+/* Creating a GtkPrintUnixDialog loads the print backends, which then
+ * have to discover printers before the dialog is useful. After a print
+ * request we keep one spare dialog around, created when idle, so that
+ * its backends have already enumerated the printers and keep the list
+ * up to date while we wait for the next request. Sessions that never
+ * print don't pay for this, and the spare dialog goes away again when
+ * there has been no request for a while.
+ */
+#define SPARE_DIALOG_TIMEOUT 300
+
+static GtkWidget *spare_dialog;
+static guint spare_dialog_id;
+static guint spare_dialog_timeout_id;
+
+static gboolean
+destroy_spare_dialog (gpointer data)
+{
+  spare_dialog_timeout_id = 0;
+
+  if (spare_dialog)
+    {
+      gtk_widget_destroy (g_steal_pointer (&spare_dialog));
+      g_debug ("Destroyed unused spare print dialog");
+    }
+
+  return G_SOURCE_REMOVE;
+}
+
+static gboolean
+create_spare_dialog (gpointer data)
+{
+  spare_dialog_id = 0;
+
+  if (spare_dialog == NULL)
+    {
+      spare_dialog = gtk_print_unix_dialog_new (NULL, NULL);
+      g_debug ("Created spare print dialog");
+    }
+
+  if (spare_dialog_timeout_id == 0)
+    spare_dialog_timeout_id = g_timeout_add_seconds (SPARE_DIALOG_TIMEOUT,
+                                                     destroy_spare_dialog,
+                                                     NULL);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+queue_spare_dialog (void)
+{
+  if (spare_dialog == NULL && spare_dialog_id == 0)
+    spare_dialog_id = g_idle_add_full (G_PRIORITY_LOW, create_spare_dialog, NULL, NULL);
+}
+
+static GtkWidget *
+get_print_dialog (const char *title,
+                  GdkScreen *screen)
+{
+  GtkWidget *dialog;
+
+  if (spare_dialog_timeout_id != 0)
+    {
+      g_source_remove (spare_dialog_timeout_id);
+      spare_dialog_timeout_id = 0;
+    }
+
+  if (spare_dialog)
+    {
+      dialog = g_steal_pointer (&spare_dialog);
+      gtk_window_set_title (GTK_WINDOW (dialog), title);
+      gtk_window_set_screen (GTK_WINDOW (dialog), screen);
+    }
+  else
+    {
+      dialog = gtk_print_unix_dialog_new (title, NULL);
+    }
+
+  queue_spare_dialog ();
+
+  return dialog;
+}
+
 static gboolean
 handle_print (XdpImplPrint *object,
               GDBusMethodInvocation *invocation,
@@ -421,7 +1080,6 @@ handle_print (XdpImplPrint *object,
   PrintParams *params;
   int idx, fd;
   gboolean modal;
-  GdkDisplay *display;
   GdkScreen *screen;
   ExternalWindow *external_parent = NULL;
   GtkWidget *fake_parent;
@@ -433,24 +1091,22 @@ handle_print (XdpImplPrint *object,
   params = get_print_params (arg_app_id, token);
   if (params)
     {
-      GVariantBuilder opt_builder;
+      handle = g_new0 (PrintDialogHandle, 1);
+      handle->impl = object;
+      handle->invocation = invocation;
+      handle->fd = fd;
 
       print_file (fd,
                   params->app_id,
-		  params->preview,
+                  params->preview,
                   params->printer,
                   params->settings,
                   params->page_setup,
-                  NULL);
+                  print_file_done,
+                  handle);
 
       print_params_free (params);
 
-      g_variant_builder_init (&opt_builder, G_VARIANT_TYPE_VARDICT);
-      xdp_impl_print_complete_print (object,
-                                     invocation,
-                                     NULL,
-                                     0,
-                                     g_variant_builder_end (&opt_builder));
       return TRUE;
     }
 
@@ -465,22 +1121,13 @@ handle_print (XdpImplPrint *object,
                    arg_parent_window);
     }
 
-  if (external_parent)
-    display = external_window_get_display (external_parent);
-  else
-    display = gdk_display_get_default ();
-  screen = gdk_display_get_default_screen (display);
-
-  fake_parent = g_object_new (GTK_TYPE_WINDOW,
-                              "type", GTK_WINDOW_TOPLEVEL,
-                              "screen", screen,
-                              NULL);
-  g_object_ref_sink (fake_parent);
+  fake_parent = get_fake_parent_for_external_window (external_parent);
+  screen = gtk_window_get_screen (GTK_WINDOW (fake_parent));
 
   if (!g_variant_lookup (arg_options, "modal", "b", &modal))
     modal = TRUE;
 
-  dialog = gtk_print_unix_dialog_new (arg_title, NULL);
+  dialog = get_print_dialog (arg_title, screen);
   gtk_window_set_transient_for (GTK_WINDOW (dialog), GTK_WINDOW (fake_parent));
   gtk_window_set_modal (GTK_WINDOW (dialog), modal);
   gtk_print_unix_dialog_set_manual_capabilities (GTK_PRINT_UNIX_DIALOG (dialog),
@@ -594,7 +1241,6 @@ handle_prepare_print (XdpImplPrint *object,
   GtkPrintSettings *settings;
   GtkPageSetup *page_setup;
   gboolean modal;
-  GdkDisplay *display;
   GdkScreen *screen;
   ExternalWindow *external_parent = NULL;
   GtkWidget *fake_parent;
@@ -611,24 +1257,15 @@ handle_prepare_print (XdpImplPrint *object,
                    arg_parent_window);
     }
 
-  if (external_parent)
-    display = external_window_get_display (external_parent);
-  else
-    display = gdk_display_get_default ();
-  screen = gdk_display_get_default_screen (display);
-
-  fake_parent = g_object_new (GTK_TYPE_WINDOW,
-                              "type", GTK_WINDOW_TOPLEVEL,
-                              "screen", screen,
-                              NULL);
-  g_object_ref_sink (fake_parent);
+  fake_parent = get_fake_parent_for_external_window (external_parent);
+  screen = gtk_window_get_screen (GTK_WINDOW (fake_parent));
 
   settings = gtk_print_settings_new_from_gvariant (arg_settings);
   page_setup = gtk_page_setup_new_from_gvariant (arg_page_setup);
   if (!g_variant_lookup (arg_options, "modal", "b", &modal))
     modal = TRUE;
 
-  dialog = gtk_print_unix_dialog_new (arg_title, NULL);
+  dialog = get_print_dialog (arg_title, screen);
   gtk_window_set_transient_for (GTK_WINDOW (dialog), GTK_WINDOW (fake_parent));
   gtk_window_set_modal (GTK_WINDOW (dialog), modal);
   gtk_print_unix_dialog_set_manual_capabilities (GTK_PRINT_UNIX_DIALOG (dialog),
@@ -646,6 +1283,7 @@ handle_prepare_print (XdpImplPrint *object,
   handle->request = g_object_ref (request);
   handle->dialog = g_object_ref (dialog);
   handle->external_parent = external_parent;
+  handle->fd = -1;
 
   g_signal_connect (request, "handle-close", G_CALLBACK (handle_close), handle);
 
@@ -205,8 +205,6 @@ create_remote_desktop_dialog (RemoteDesktopSession *session,
 {
   RemoteDesktopDialogHandle *dialog_handle;
   ExternalWindow *external_parent;
-  GdkScreen *screen;
-  GdkDisplay *display;
   GtkWidget *fake_parent;
   GtkWidget *dialog;
 
@@ -222,16 +220,7 @@ create_remote_desktop_dialog (RemoteDesktopSession *session,
       external_parent = NULL;
     }
 
-  if (external_parent)
-    display = external_window_get_display (external_parent);
-  else
-    display = gdk_display_get_default ();
-  screen = gdk_display_get_default_screen (display);
-  fake_parent = g_object_new (GTK_TYPE_WINDOW,
-                              "type", GTK_WINDOW_TOPLEVEL,
-                              "screen", screen,
-                              NULL);
-  g_object_ref_sink (fake_parent);
+  fake_parent = get_fake_parent_for_external_window (external_parent);
 
   dialog =
     GTK_WIDGET (remote_desktop_dialog_new (request->app_id,
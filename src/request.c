@@ -20,6 +20,8 @@
  */
 
 #include "request.h"
+#include "trace.h"
+#include "utils.h"
 
 #include <string.h>
 
@@ -28,6 +30,113 @@ static void request_skeleton_iface_init (XdpImplRequestIface *iface);
 G_DEFINE_TYPE_WITH_CODE (Request, request, XDP_IMPL_TYPE_REQUEST_SKELETON,
                          G_IMPLEMENT_INTERFACE (XDP_IMPL_TYPE_REQUEST, request_skeleton_iface_init))
 
+/* Exported requests by the client they were made for, so that they
+ * can be closed when the client goes away without waiting for their
+ * dialogs to be dismissed.
+ */
+typedef struct {
+  char *client;
+  guint watcher_id;
+  GHashTable *requests;
+} ClientRequests;
+
+static GHashTable *clients;
+
+static void
+client_requests_free (gpointer data)
+{
+  ClientRequests *client_requests = data;
+
+  unwatch_sender (client_requests->watcher_id);
+  g_hash_table_unref (client_requests->requests);
+  g_free (client_requests->client);
+
+  g_free (client_requests);
+}
+
+static void
+close_request (Request *request)
+{
+  gboolean handled = FALSE;
+
+  /* This runs the same handle-close handlers that dismiss dialogs when
+   * the frontend closes a request, without a method call to complete.
+   */
+  g_signal_emit_by_name (request, "handle-close", NULL, &handled);
+
+  if (request->exported)
+    request_unexport (request);
+}
+
+static void
+client_vanished (const char *client,
+                 gpointer user_data)
+{
+  ClientRequests *client_requests = user_data;
+  GList *to_close, *l;
+
+  g_debug ("%s went away, closing %u requests", client,
+           g_hash_table_size (client_requests->requests));
+
+  /* Unexporting a request removes it from client_requests, and the
+   * last one frees it.
+   */
+  to_close = g_hash_table_get_keys (client_requests->requests);
+  g_list_foreach (to_close, (GFunc) g_object_ref, NULL);
+
+  for (l = to_close; l; l = l->next)
+    {
+      Request *request = l->data;
+
+      if (request->exported)
+        close_request (request);
+    }
+
+  g_list_free_full (to_close, g_object_unref);
+}
+
+static void
+add_client_request (Request *request,
+                    GDBusConnection *connection)
+{
+  ClientRequests *client_requests;
+
+  if (request->client == NULL)
+    return;
+
+  client_requests = g_hash_table_lookup (clients, request->client);
+  if (client_requests == NULL)
+    {
+      client_requests = g_new0 (ClientRequests, 1);
+      client_requests->client = g_strdup (request->client);
+      client_requests->requests = g_hash_table_new (NULL, NULL);
+      client_requests->watcher_id = watch_sender (connection,
+                                                  request->client,
+                                                  client_vanished,
+                                                  client_requests);
+      g_hash_table_insert (clients, client_requests->client, client_requests);
+    }
+
+  g_hash_table_add (client_requests->requests, request);
+}
+
+static void
+remove_client_request (Request *request)
+{
+  ClientRequests *client_requests;
+
+  if (request->client == NULL)
+    return;
+
+  client_requests = g_hash_table_lookup (clients, request->client);
+  if (client_requests == NULL)
+    return;
+
+  if (g_hash_table_remove (client_requests->requests, request) &&
+      g_hash_table_size (client_requests->requests) == 0)
+    g_hash_table_remove (clients, request->client);
+}
+
 static gboolean
 handle_close (XdpImplRequest *object,
               GDBusMethodInvocation *invocation)
@@ -38,7 +147,9 @@ handle_close (XdpImplRequest *object,
   if (request->exported)
     request_unexport (request);
 
-  xdp_impl_request_complete_close (XDP_IMPL_REQUEST (request), invocation);
+  /* NULL when closing requests for a client that went away */
+  if (invocation)
+    xdp_impl_request_complete_close (XDP_IMPL_REQUEST (request), invocation);
 
   return TRUE;
 }
@@ -59,6 +170,9 @@ request_finalize (GObject *object)
 {
   Request *request = (Request *)object;
 
+  remove_client_request (request);
+
+  g_free (request->client);
   g_free (request->sender);
   g_free (request->app_id);
   g_free (request->id);
@@ -73,6 +187,9 @@ request_class_init (RequestClass *klass)
 
   gobject_class = G_OBJECT_CLASS (klass);
   gobject_class->finalize  = request_finalize;
+
+  clients = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                   NULL, client_requests_free);
 }
 
 Request *
@@ -86,6 +203,8 @@ request_new (const char *sender,
   request->sender = g_strdup (sender);
   request->app_id = g_strdup (app_id);
   request->id = g_strdup (id);
+  request->client = get_sender_from_handle (id);
+  request->start_time = TRACE_CURRENT_TIME;
 
   return request;
 }
@@ -107,11 +226,22 @@ request_export (Request *request,
 
   g_object_ref (request);
   request->exported = TRUE;
+
+  add_client_request (request, connection);
+
+  /* Dialog portals export the request once the dialog is up */
+  trace_mark (request->start_time, TRACE_CURRENT_TIME - request->start_time,
+              "request-setup", "%s %s", request->app_id, request->id);
 }
 
 void
 request_unexport (Request *request)
 {
+  trace_mark (request->start_time, TRACE_CURRENT_TIME - request->start_time,
+              "request", "%s %s", request->app_id, request->id);
+
+  remove_client_request (request);
+
   request->exported = FALSE;
   g_dbus_interface_skeleton_unexport (G_DBUS_INTERFACE_SKELETON (request));
   g_object_unref (request);
@@ -34,6 +34,9 @@ struct _Request
   char *sender;
   char *app_id;
   char *id;
+  char *client;
+
+  gint64 start_time;
 };
 
 struct _RequestClass
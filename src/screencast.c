@@ -19,7 +19,9 @@
 #include "config.h"
 
 #include <gio/gio.h>
+#include <gio/gdesktopappinfo.h>
 #include <glib-object.h>
+#include <glib/gi18n.h>
 #include <stdint.h>
 
 #include "xdg-desktop-portal-dbus.h"
@@ -31,6 +33,7 @@
 #include "remotedesktop.h"
 #include "displaystatetracker.h"
 #include "externalwindow.h"
+#include "fdonotification.h"
 #include "request.h"
 #include "session.h"
 #include "utils.h"
@@ -53,6 +56,8 @@ typedef struct _ScreenCastSession
 
   GDBusMethodInvocation *start_invocation;
   ScreenCastDialogHandle *dialog_handle;
+
+  char *notified_app_id;
 } ScreenCastSession;
 
 typedef struct _ScreenCastSessionClass
@@ -76,6 +81,9 @@ static GDBusInterfaceSkeleton *impl;
 
 static GnomeScreenCast *gnome_screen_cast;
 
+/* Monitor selections the user asked us to remember, by app id */
+static GKeyFile *selections_keyfile;
+
 GType screen_cast_session_get_type (void);
 G_DEFINE_TYPE (ScreenCastSession, screen_cast_session, session_get_type ())
 
@@ -125,6 +133,234 @@ handle_close (XdpImplRequest *object,
   return FALSE;
 }
 
+static char *
+get_selections_keyfile_path (void)
+{
+  return g_build_filename (g_get_user_config_dir (),
+                           "xdg-desktop-portal-gtk",
+                           "screencast-selections",
+                           NULL);
+}
+
+static GKeyFile *
+get_selections_keyfile (void)
+{
+  if (!selections_keyfile)
+    {
+      g_autofree char *path = get_selections_keyfile_path ();
+      g_autoptr(GError) error = NULL;
+
+      selections_keyfile = g_key_file_new ();
+      if (!g_key_file_load_from_file (selections_keyfile, path,
+                                      G_KEY_FILE_NONE, &error) &&
+          !g_error_matches (error, G_FILE_ERROR, G_FILE_ERROR_NOENT))
+        g_warning ("Failed to load screen cast selections: %s", error->message);
+    }
+
+  return selections_keyfile;
+}
+
+static void
+save_selections_keyfile (void)
+{
+  g_autofree char *path = get_selections_keyfile_path ();
+  g_autofree char *dir = g_path_get_dirname (path);
+  g_autoptr(GError) error = NULL;
+
+  if (g_mkdir_with_parents (dir, 0700) != 0)
+    {
+      g_warning ("Failed to create %s", dir);
+      return;
+    }
+
+  if (!g_key_file_save_to_file (selections_keyfile, path, &error))
+    g_warning ("Failed to save screen cast selections: %s", error->message);
+}
+
+static void
+remember_selections (const char *app_id,
+                     GVariant *selections)
+{
+  g_autoptr(GVariant) source_selections = NULL;
+  g_autoptr(GPtrArray) connectors = NULL;
+  GKeyFile *keyfile;
+  gboolean remember = FALSE;
+  GVariantIter iter;
+  ScreenCastSourceType source_type;
+  GVariant *variant;
+
+  if (!app_id || app_id[0] == '\0')
+    return;
+
+  keyfile = get_selections_keyfile ();
+
+  g_variant_lookup (selections, "remember", "b", &remember);
+  g_variant_lookup (selections, "selected_screen_cast_sources", "@a(u?)",
+                    &source_selections);
+
+  connectors = g_ptr_array_new_with_free_func (g_free);
+  if (remember && source_selections)
+    {
+      g_variant_iter_init (&iter, source_selections);
+      while (g_variant_iter_next (&iter, "(u?)", &source_type, &variant))
+        {
+          if (source_type == SCREEN_CAST_SOURCE_TYPE_MONITOR)
+            g_ptr_array_add (connectors, g_variant_dup_string (variant, NULL));
+          else
+            remember = FALSE;
+
+          g_variant_unref (variant);
+        }
+    }
+
+  if (remember && connectors->len > 0)
+    {
+      g_key_file_set_string_list (keyfile, app_id, "monitors",
+                                  (const char * const *) connectors->pdata,
+                                  connectors->len);
+    }
+  else if (!g_key_file_remove_group (keyfile, app_id, NULL))
+    {
+      return;
+    }
+
+  save_selections_keyfile ();
+}
+
+static void
+forget_selections (const char *app_id)
+{
+  g_debug ("Forgetting screen cast selections for %s", app_id);
+
+  if (g_key_file_remove_group (get_selections_keyfile (), app_id, NULL))
+    save_selections_keyfile ();
+}
+
+static void
+activate_action (GDBusConnection *connection,
+                 const char *app_id,
+                 const char *id,
+                 const char *name,
+                 GVariant *parameter,
+                 gpointer data)
+{
+  if (g_str_equal (name, "forget") &&
+      parameter && g_variant_is_of_type (parameter, G_VARIANT_TYPE_STRING))
+    forget_selections (g_variant_get_string (parameter, NULL));
+}
+
+/* Starting a screen cast without asking is announced with a
+ * notification, which also lets the user take the permission back.
+ */
+static void
+notify_remembered_selections (const char *app_id)
+{
+  g_autofree char *desktop_id = NULL;
+  g_autoptr(GDesktopAppInfo) info = NULL;
+  g_autofree char *id = NULL;
+  g_autofree char *body = NULL;
+  GVariantBuilder builder;
+  GVariantBuilder bbuilder;
+  GVariantBuilder button;
+  const char *name;
+
+  desktop_id = g_strconcat (app_id, ".desktop", NULL);
+  info = g_desktop_app_info_new (desktop_id);
+  if (info)
+    name = g_app_info_get_display_name (G_APP_INFO (info));
+  else
+    name = app_id;
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
+  g_variant_builder_add (&builder, "{sv}", "title", g_variant_new_string (_("Screen Sharing")));
+
+  body = g_strdup_printf (_("%s is sharing your screen, as you chose before."), name);
+  g_variant_builder_add (&builder, "{sv}", "body", g_variant_new_string (body));
+
+  g_variant_builder_init (&bbuilder, G_VARIANT_TYPE ("aa{sv}"));
+  g_variant_builder_init (&button, G_VARIANT_TYPE_VARDICT);
+  g_variant_builder_add (&button, "{sv}", "label", g_variant_new_string (_("Stop Remembering")));
+  g_variant_builder_add (&button, "{sv}", "action", g_variant_new_string ("forget"));
+  g_variant_builder_add (&button, "{sv}", "target", g_variant_new_string (app_id));
+
+  g_variant_builder_add (&bbuilder, "@a{sv}", g_variant_builder_end (&button));
+
+  g_variant_builder_add (&builder, "{sv}", "buttons", g_variant_builder_end (&bbuilder));
+
+  id = g_strdup_printf ("screen_cast_%s", app_id);
+  fdo_remove_notification (impl_connection, "", id);
+  fdo_add_notification (impl_connection, "", id, g_variant_builder_end (&builder),
+                        activate_action, NULL);
+}
+
+static gboolean
+is_monitor_connected (const char *connector)
+{
+  GPtrArray *logical_monitors;
+  guint i, j;
+
+  logical_monitors =
+    display_state_tracker_get_logical_monitors (display_state_tracker_get ());
+  for (i = 0; i < logical_monitors->len; i++)
+    {
+      GPtrArray *monitors = logical_monitor_get_monitors (logical_monitors->pdata[i]);
+
+      for (j = 0; j < monitors->len; j++)
+        {
+          if (g_strcmp0 (monitor_get_connector (monitors->pdata[j]), connector) == 0)
+            return TRUE;
+        }
+    }
+
+  return FALSE;
+}
+
+/* Returns the remembered selections for @app_id in the form the
+ * dialog reports them, if they can be used for @select as they are.
+ */
+static GVariant *
+lookup_remembered_selections (const char *app_id,
+                              ScreenCastSelection *select)
+{
+  g_auto(GStrv) connectors = NULL;
+  gsize n_connectors;
+  GVariantBuilder source_selections_builder;
+  GVariantBuilder selections_builder;
+  gsize i;
+
+  if (!app_id || app_id[0] == '\0' ||
+      !(select->source_types & SCREEN_CAST_SOURCE_TYPE_MONITOR))
+    return NULL;
+
+  connectors = g_key_file_get_string_list (get_selections_keyfile (),
+                                           app_id, "monitors",
+                                           &n_connectors, NULL);
+  if (!connectors || n_connectors == 0)
+    return NULL;
+
+  if (n_connectors > 1 && !select->multiple)
+    return NULL;
+
+  for (i = 0; i < n_connectors; i++)
+    {
+      if (!is_monitor_connected (connectors[i]))
+        return NULL;
+    }
+
+  g_variant_builder_init (&source_selections_builder, G_VARIANT_TYPE ("a(u?)"));
+  for (i = 0; i < n_connectors; i++)
+    g_variant_builder_add (&source_selections_builder, "(u?)",
+                           SCREEN_CAST_SOURCE_TYPE_MONITOR,
+                           g_variant_new_string (connectors[i]));
+
+  g_variant_builder_init (&selections_builder, G_VARIANT_TYPE_VARDICT);
+  g_variant_builder_add (&selections_builder, "{sv}",
+                         "selected_screen_cast_sources",
+                         g_variant_builder_end (&source_selections_builder));
+
+  return g_variant_ref_sink (g_variant_builder_end (&selections_builder));
+}
+
 static void
 screen_cast_dialog_done (GtkWidget *widget,
                          int dialog_response,
@@ -160,6 +396,10 @@ screen_cast_dialog_done (GtkWidget *widget,
           g_warning ("Failed to start session: %s", error->message);
           response = 2;
         }
+      else
+        {
+          remember_selections (dialog_handle->request->app_id, selections);
+        }
     }
 
   if (response != 0)
@@ -177,8 +417,6 @@ create_screen_cast_dialog (ScreenCastSession *session,
 {
   ScreenCastDialogHandle *dialog_handle;
   ExternalWindow *external_parent;
-  GdkScreen *screen;
-  GdkDisplay *display;
   GtkWidget *fake_parent;
   GtkWidget *dialog;
 
@@ -194,16 +432,7 @@ create_screen_cast_dialog (ScreenCastSession *session,
       external_parent = NULL;
     }
 
-  if (external_parent)
-    display = external_window_get_display (external_parent);
-  else
-    display = gdk_display_get_default ();
-  screen = gdk_display_get_default_screen (display);
-  fake_parent = g_object_new (GTK_TYPE_WINDOW,
-                              "type", GTK_WINDOW_TOPLEVEL,
-                              "screen", screen,
-                              NULL);
-  g_object_ref_sink (fake_parent);
+  fake_parent = get_fake_parent_for_external_window (external_parent);
 
   dialog = GTK_WIDGET (screen_cast_dialog_new (request->app_id,
                                                &session->select));
@@ -431,6 +660,7 @@ start_session (ScreenCastSession *screen_cast_session,
                    "org.gnome.Mutter.ScreenCast API version %d lower "
                    "than minimum supported version %d",
                    gnome_api_version, SUPPORTED_MUTTER_SCREEN_CAST_API_VERSION);
+      g_object_unref (gnome_screen_cast_session);
       g_clear_object (&gnome_screen_cast);
       return FALSE;
     }
@@ -460,6 +690,27 @@ start_session (ScreenCastSession *screen_cast_session,
   return TRUE;
 }
 
+static void
+stop_gnome_screen_cast_session (ScreenCastSession *screen_cast_session)
+{
+  GnomeScreenCastSession *gnome_screen_cast_session;
+  g_autoptr(GError) error = NULL;
+
+  gnome_screen_cast_session = screen_cast_session->gnome_screen_cast_session;
+  if (gnome_screen_cast_session)
+    {
+      g_signal_handler_disconnect (gnome_screen_cast_session,
+                                   screen_cast_session->session_ready_handler_id);
+      g_signal_handler_disconnect (gnome_screen_cast_session,
+                                   screen_cast_session->session_closed_handler_id);
+      if (!gnome_screen_cast_session_stop (gnome_screen_cast_session,
+                                           &error))
+        g_warning ("Failed to close GNOME screen cast session: %s",
+                   error->message);
+      g_clear_object (&screen_cast_session->gnome_screen_cast_session);
+    }
+}
+
 static void
 cancel_start_session (ScreenCastSession *screen_cast_session,
                       int response)
@@ -471,6 +722,10 @@ cancel_start_session (ScreenCastSession *screen_cast_session,
                                        screen_cast_session->start_invocation,
                                        response,
                                        g_variant_builder_end (&results_builder));
+  screen_cast_session->start_invocation = NULL;
+
+  /* Starting may have failed half way through */
+  stop_gnome_screen_cast_session (screen_cast_session);
 }
 
 static gboolean
@@ -486,6 +741,7 @@ handle_start (XdpImplScreenCast *object,
   g_autoptr(Request) request = NULL;
   ScreenCastSession *screen_cast_session;
   ScreenCastDialogHandle *dialog_handle;
+  g_autoptr(GVariant) selections = NULL;
   GVariantBuilder results_builder;
 
   sender = g_dbus_method_invocation_get_sender (invocation);
@@ -507,6 +763,34 @@ handle_start (XdpImplScreenCast *object,
       goto err;
     }
 
+  /* The user asked us to share the same monitors with this app again */
+  selections = lookup_remembered_selections (arg_app_id,
+                                             &screen_cast_session->select);
+  if (selections)
+    {
+      g_autoptr(GError) error = NULL;
+
+      screen_cast_session->start_invocation = invocation;
+
+      if (start_session (screen_cast_session, selections, &error))
+        {
+          notify_remembered_selections (arg_app_id);
+          g_free (screen_cast_session->notified_app_id);
+          screen_cast_session->notified_app_id = g_strdup (arg_app_id);
+
+          if (request->exported)
+            request_unexport (request);
+
+          return TRUE;
+        }
+
+      /* The selection is kept; only this time the user is asked again */
+      g_warning ("Failed to start session with remembered selections: %s",
+                 error->message);
+      stop_gnome_screen_cast_session (screen_cast_session);
+      screen_cast_session->start_invocation = NULL;
+    }
+
   dialog_handle = create_screen_cast_dialog (screen_cast_session,
                                              invocation,
                                              request,
@@ -545,6 +829,9 @@ on_gnome_screen_cast_enabled (GnomeScreenCast *gnome_screen_cast)
 
   gnome_api_version = gnome_screen_cast_get_api_version (gnome_screen_cast);
 
+  /* Remembered selections are checked against the connected monitors */
+  display_state_tracker_get ();
+
   available_source_types = SCREEN_CAST_SOURCE_TYPE_MONITOR;
   if (gnome_api_version >= 2)
     available_source_types |= SCREEN_CAST_SOURCE_TYPE_WINDOW;
@@ -607,21 +894,17 @@ static void
 screen_cast_session_close (Session *session)
 {
   ScreenCastSession *screen_cast_session = (ScreenCastSession *)session;
-  GnomeScreenCastSession *gnome_screen_cast_session;
-  g_autoptr(GError) error = NULL;
 
-  gnome_screen_cast_session = screen_cast_session->gnome_screen_cast_session;
-  if (gnome_screen_cast_session)
+  stop_gnome_screen_cast_session (screen_cast_session);
+
+  if (screen_cast_session->notified_app_id)
     {
-      g_signal_handler_disconnect (gnome_screen_cast_session,
-                                   screen_cast_session->session_ready_handler_id);
-      g_signal_handler_disconnect (gnome_screen_cast_session,
-                                   screen_cast_session->session_closed_handler_id);
-      if (!gnome_screen_cast_session_stop (gnome_screen_cast_session,
-                                           &error))
-        g_warning ("Failed to close GNOME screen cast session: %s",
-                   error->message);
-      g_clear_object (&screen_cast_session->gnome_screen_cast_session);
+      g_autofree char *id = NULL;
+
+      id = g_strdup_printf ("screen_cast_%s",
+                            screen_cast_session->notified_app_id);
+      fdo_remove_notification (impl_connection, "", id);
+      g_clear_pointer (&screen_cast_session->notified_app_id, g_free);
     }
 }
 
@@ -631,6 +914,7 @@ screen_cast_session_finalize (GObject *object)
   ScreenCastSession *screen_cast_session = (ScreenCastSession *)object;
 
   g_clear_object (&screen_cast_session->gnome_screen_cast_session);
+  g_free (screen_cast_session->notified_app_id);
 
   G_OBJECT_CLASS (screen_cast_session_parent_class)->finalize (object);
 }
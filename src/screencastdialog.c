@@ -31,6 +31,7 @@ struct _ScreenCastDialog
 
   GtkWidget *accept_button;
   GtkWidget *screen_cast_widget;
+  GtkWidget *remember_button;
 
   gboolean multiple;
 };
@@ -71,6 +72,9 @@ button_clicked (GtkWidget *button,
       g_variant_builder_init (&selections_builder, G_VARIANT_TYPE ("a{sv}"));
       screen_cast_widget_add_selections (screen_cast_widget,
                                          &selections_builder);
+      if (gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON (dialog->remember_button)))
+        g_variant_builder_add (&selections_builder, "{sv}",
+                               "remember", g_variant_new_boolean (TRUE));
       selections = g_variant_builder_end (&selections_builder);
     }
   else
@@ -107,6 +111,11 @@ screen_cast_dialog_new (const char *app_id,
   screen_cast_widget_set_source_types (screen_cast_widget,
                                        select->source_types);
 
+  /* Only monitor selections can be restored later */
+  gtk_widget_set_visible (dialog->remember_button,
+                          app_id && app_id[0] != '\0' &&
+                          (select->source_types & SCREEN_CAST_SOURCE_TYPE_MONITOR));
+
   return dialog;
 }
 
@@ -152,5 +161,6 @@ screen_cast_dialog_class_init (ScreenCastDialogClass *klass)
   gtk_widget_class_set_template_from_resource (widget_class, "/org/freedesktop/portal/desktop/gtk/screencastdialog.ui");
   gtk_widget_class_bind_template_child (widget_class, ScreenCastDialog, accept_button);
   gtk_widget_class_bind_template_child (widget_class, ScreenCastDialog, screen_cast_widget);
+  gtk_widget_class_bind_template_child (widget_class, ScreenCastDialog, remember_button);
   gtk_widget_class_bind_template_callback (widget_class, button_clicked);
 }
@@ -25,6 +25,9 @@
 #include "screencastwidget.h"
 #include "displaystatetracker.h"
 #include "shellintrospect.h"
+#ifdef HAVE_WINDOW_THUMBNAILS
+#include "windowthumbnailer.h"
+#endif
 
 enum
 {
@@ -46,6 +49,7 @@ struct _ScreenCastWidget
 
   GtkWidget *monitor_heading;
   GtkWidget *monitor_list;
+  GHashTable *monitor_rows;
 
   GtkWidget *window_heading;
   GtkWidget *window_list;
@@ -56,68 +60,181 @@ struct _ScreenCastWidget
 
   ShellIntrospect *shell_introspect;
   gulong windows_changed_handler_id;
+  GHashTable *window_widgets;
+
+#ifdef HAVE_WINDOW_THUMBNAILS
+  WindowThumbnailer *window_thumbnailer;
+  gulong thumbnail_ready_handler_id;
+  guint update_thumbnails_id;
+#endif
 
   guint selection_changed_timeout_id;
 };
 
+/* The Window structs are replaced whenever the window list is
+ * refetched, so rows only remember what they show.
+ */
+typedef struct
+{
+  uint64_t id;
+  char *app_id;
+  GtkWidget *window_widget;
+  GtkWidget *window_label;
+  GtkWidget *window_image;
+#ifdef HAVE_WINDOW_THUMBNAILS
+  GtkWidget *thumbnail_image;
+#endif
+} WindowWidgetData;
+
 static GQuark quark_monitor_widget_data;
 static GQuark quark_window_widget_data;
 
+static GHashTable *app_icons;
+
 G_DEFINE_TYPE (ScreenCastWidget, screen_cast_widget, GTK_TYPE_BOX)
 
-static GtkWidget *
+static void
+window_widget_data_free (gpointer data)
+{
+  WindowWidgetData *window_data = data;
+
+  g_free (window_data->app_id);
+  g_free (window_data);
+}
+
+static void
+app_infos_changed (GAppInfoMonitor *monitor,
+                   gpointer user_data)
+{
+  g_hash_table_remove_all (app_icons);
+}
+
+static GIcon *
+lookup_app_icon (const char *app_id)
+{
+  GIcon *icon;
+
+  if (app_id == NULL)
+    app_id = "";
+
+  if (app_icons == NULL)
+    {
+      app_icons = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                         g_free, g_object_unref);
+      g_signal_connect (g_app_info_monitor_get (), "changed",
+                        G_CALLBACK (app_infos_changed), NULL);
+    }
+
+  icon = g_hash_table_lookup (app_icons, app_id);
+  if (icon == NULL)
+    {
+      g_autoptr(GDesktopAppInfo) info = NULL;
+
+      if (app_id[0] != '\0')
+        info = g_desktop_app_info_new (app_id);
+      if (info != NULL)
+        icon = g_app_info_get_icon (G_APP_INFO (info));
+      if (icon != NULL)
+        g_object_ref (icon);
+      else
+        icon = g_themed_icon_new ("application-x-executable");
+
+      g_hash_table_insert (app_icons, g_strdup (app_id), icon);
+    }
+
+  return icon;
+}
+
+static void
+update_window_widget (WindowWidgetData *window_data,
+                      Window *window)
+{
+  if (g_strcmp0 (window_data->app_id, window_get_app_id (window)) != 0)
+    {
+      g_free (window_data->app_id);
+      window_data->app_id = g_strdup (window_get_app_id (window));
+      gtk_image_set_from_gicon (GTK_IMAGE (window_data->window_image),
+                                lookup_app_icon (window_data->app_id),
+                                GTK_ICON_SIZE_DND);
+    }
+
+  if (g_strcmp0 (gtk_label_get_label (GTK_LABEL (window_data->window_label)),
+                 window_get_title (window)) != 0)
+    gtk_label_set_label (GTK_LABEL (window_data->window_label),
+                         window_get_title (window));
+}
+
+static WindowWidgetData *
 create_window_widget (Window *window)
 {
+  WindowWidgetData *window_data;
   GtkWidget *window_widget;
   GtkWidget *window_label;
   GtkWidget *window_image;
-  GIcon *icon = NULL;
-  g_autoptr(GDesktopAppInfo) info = NULL;
 
   window_widget = gtk_box_new (GTK_ORIENTATION_HORIZONTAL, 12);
   gtk_widget_set_margin_start (window_widget, 12);
   gtk_widget_set_margin_end (window_widget, 12);
-  info = g_desktop_app_info_new (window_get_app_id (window));
-  if (info != NULL)
-    icon = g_app_info_get_icon (G_APP_INFO (info));
-  if (icon == NULL)
-    icon = g_themed_icon_new ("application-x-executable");
-  window_image = gtk_image_new_from_gicon (icon, GTK_ICON_SIZE_DND);
+  window_image = gtk_image_new ();
   gtk_widget_set_margin_start (window_image, 12);
   gtk_widget_set_margin_end (window_image, 12);
   gtk_widget_show (window_image);
 
   gtk_container_add (GTK_CONTAINER (window_widget), window_image);
 
-  window_label = gtk_label_new (window_get_title (window));
+  window_label = gtk_label_new (NULL);
   gtk_widget_set_margin_top (window_label, 12);
   gtk_widget_set_margin_bottom (window_label, 12);
   gtk_widget_show (window_label);
   gtk_container_add (GTK_CONTAINER (window_widget), window_label);
 
-  g_object_set_qdata (G_OBJECT (window_widget),
-                      quark_window_widget_data,
-                      window);
+  window_data = g_new0 (WindowWidgetData, 1);
+  window_data->id = window_get_id (window);
+  window_data->window_widget = window_widget;
+  window_data->window_label = window_label;
+  window_data->window_image = window_image;
+
+#ifdef HAVE_WINDOW_THUMBNAILS
+  /* Shown once the first frame of the window has been captured. */
+  window_data->thumbnail_image = gtk_image_new ();
+  gtk_widget_set_margin_top (window_data->thumbnail_image, 6);
+  gtk_widget_set_margin_bottom (window_data->thumbnail_image, 6);
+  gtk_box_pack_end (GTK_BOX (window_widget), window_data->thumbnail_image,
+                    FALSE, FALSE, 0);
+#endif
+  g_object_set_qdata_full (G_OBJECT (window_widget),
+                           quark_window_widget_data,
+                           window_data,
+                           window_widget_data_free);
+
+  gtk_image_set_from_gicon (GTK_IMAGE (window_image),
+                            lookup_app_icon (window_get_app_id (window)),
+                            GTK_ICON_SIZE_DND);
+  window_data->app_id = g_strdup (window_get_app_id (window));
+  update_window_widget (window_data, window);
+
   gtk_widget_show (window_widget);
-  return window_widget;
+  return window_data;
 }
 
 static GtkWidget *
 create_monitor_widget (LogicalMonitor *logical_monitor)
 {
   GtkWidget *monitor_widget;
-  GList *l;
+  GPtrArray *monitors;
+  guint i;
 
   monitor_widget = gtk_box_new (GTK_ORIENTATION_VERTICAL, 12);
   gtk_widget_set_margin_start (monitor_widget, 12);
   gtk_widget_set_margin_end (monitor_widget, 12);
 
-  for (l = logical_monitor_get_monitors (logical_monitor); l; l = l->next)
+  monitors = logical_monitor_get_monitors (logical_monitor);
+  for (i = 0; i < monitors->len; i++)
     {
-      Monitor *monitor = l->data;
+      Monitor *monitor = monitors->pdata[i];
       GtkWidget *monitor_label;
 
-      if (!l->prev)
+      if (i == 0)
         g_object_set_qdata (G_OBJECT (monitor_widget),
                             quark_monitor_widget_data,
                             monitor);
@@ -155,69 +272,258 @@ should_skip_window (Window *window,
   return TRUE;
 }
 
+#ifdef HAVE_WINDOW_THUMBNAILS
 static void
-update_windows_list (ScreenCastWidget *widget)
+on_thumbnail_ready (WindowThumbnailer *thumbnailer,
+                    guint64 window_id,
+                    GdkPixbuf *pixbuf,
+                    ScreenCastWidget *widget)
 {
-  GtkListBox *window_list = GTK_LIST_BOX (widget->window_list);
-  GList *old_window_widgets;
-  GtkWidget *toplevel;
-  GList *windows;
+  WindowWidgetData *window_data;
+
+  window_data = g_hash_table_lookup (widget->window_widgets, &window_id);
+  if (!window_data)
+    return;
+
+  gtk_image_set_from_pixbuf (GTK_IMAGE (window_data->thumbnail_image), pixbuf);
+  gtk_widget_show (window_data->thumbnail_image);
+}
+
+/* Only the rows scrolled into view are captured, and nothing at all
+ * while the monitor page is showing.
+ */
+static gboolean
+update_thumbnails_idle (gpointer user_data)
+{
+  ScreenCastWidget *widget = user_data;
+  g_autoptr(GArray) window_ids = NULL;
+  GtkWidget *visible_child;
+  int viewport_height;
+  GList *rows;
   GList *l;
 
-  old_window_widgets = gtk_container_get_children (GTK_CONTAINER (window_list));
-  for (l = old_window_widgets; l; l = l->next)
+  widget->update_thumbnails_id = 0;
+
+  window_ids = g_array_new (FALSE, FALSE, sizeof (uint64_t));
+
+  visible_child = gtk_stack_get_visible_child (GTK_STACK (widget->source_type));
+  viewport_height = gtk_widget_get_allocated_height (widget->window_list_scrolled);
+
+  rows = visible_child == widget->window_selection
+    ? gtk_container_get_children (GTK_CONTAINER (widget->window_list))
+    : NULL;
+  for (l = rows; l; l = l->next)
     {
-      GtkWidget *window_widget = l->data;
+      GtkWidget *row = l->data;
+      WindowWidgetData *window_data;
+      int y;
+
+      if (!gtk_widget_translate_coordinates (row, widget->window_list_scrolled,
+                                             0, 0, NULL, &y))
+        continue;
 
-      gtk_container_remove (GTK_CONTAINER (window_list), window_widget);
+      if (y + gtk_widget_get_allocated_height (row) <= 0 ||
+          y >= viewport_height)
+        continue;
+
+      window_data = g_object_get_qdata (G_OBJECT (gtk_bin_get_child (GTK_BIN (row))),
+                                        quark_window_widget_data);
+      g_array_append_val (window_ids, window_data->id);
     }
-  g_list_free (old_window_widgets);
+  g_list_free (rows);
 
-  toplevel = gtk_widget_get_ancestor (GTK_WIDGET (widget), GTK_TYPE_WINDOW);
-  if (!toplevel)
+  if (window_ids->len > 0 && !widget->window_thumbnailer)
+    {
+      widget->window_thumbnailer = window_thumbnailer_new ();
+      widget->thumbnail_ready_handler_id =
+        g_signal_connect (widget->window_thumbnailer, "thumbnail-ready",
+                          G_CALLBACK (on_thumbnail_ready),
+                          widget);
+    }
+
+  if (widget->window_thumbnailer)
+    window_thumbnailer_set_windows (widget->window_thumbnailer,
+                                    (uint64_t *) window_ids->data,
+                                    window_ids->len);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+schedule_update_thumbnails (ScreenCastWidget *widget)
+{
+  if (widget->update_thumbnails_id)
     return;
 
-  windows = shell_introspect_get_windows (widget->shell_introspect);
-  for (l = windows; l; l = l->next)
+  widget->update_thumbnails_id = g_idle_add (update_thumbnails_idle, widget);
+}
+
+static void
+on_window_list_scrolled (GtkAdjustment *adjustment,
+                         ScreenCastWidget *widget)
+{
+  schedule_update_thumbnails (widget);
+}
+
+static void
+on_window_list_size_allocate (GtkWidget *window_list,
+                              GdkRectangle *allocation,
+                              ScreenCastWidget *widget)
+{
+  schedule_update_thumbnails (widget);
+}
+#endif
+
+/* Where a new row for the window goes, so that rows stay in the
+ * order of the shell's window list.
+ */
+static int
+get_window_position (ScreenCastWidget *widget,
+                     Window *window)
+{
+  GList *l;
+  int position = 0;
+
+  for (l = shell_introspect_get_windows (widget->shell_introspect); l; l = l->next)
     {
-      Window *window = l->data;
-      GtkWidget *window_widget;
+      uint64_t id = window_get_id (l->data);
 
-      if (should_skip_window (window, GTK_WINDOW (toplevel)))
-        continue;
+      if (l->data == window)
+        return position;
 
-      window_widget = create_window_widget (window);
-      gtk_container_add (GTK_CONTAINER (window_list), window_widget);
+      if (g_hash_table_contains (widget->window_widgets, &id))
+        position++;
     }
+
+  return -1;
 }
 
 static void
-update_monitors_list (ScreenCastWidget *widget)
+remove_window_widget (ScreenCastWidget *widget,
+                      uint64_t id)
 {
-  GtkListBox *monitor_list = GTK_LIST_BOX (widget->monitor_list);
-  GList *old_monitor_widgets;
-  GList *logical_monitors;
+  WindowWidgetData *window_data;
+  GtkWidget *row;
+
+  window_data = g_hash_table_lookup (widget->window_widgets, &id);
+  if (!window_data)
+    return;
+
+  row = gtk_widget_get_parent (window_data->window_widget);
+  g_hash_table_remove (widget->window_widgets, &id);
+  gtk_container_remove (GTK_CONTAINER (widget->window_list), row);
+}
+
+static void
+add_window_widget (ScreenCastWidget *widget,
+                   Window *window,
+                   GtkWindow *toplevel,
+                   int position)
+{
+  WindowWidgetData *window_data;
+  uint64_t id = window_get_id (window);
+
+  if (should_skip_window (window, toplevel))
+    {
+      remove_window_widget (widget, id);
+      return;
+    }
+
+  window_data = g_hash_table_lookup (widget->window_widgets, &id);
+  if (window_data)
+    {
+      update_window_widget (window_data, window);
+    }
+  else
+    {
+      window_data = create_window_widget (window);
+      g_hash_table_insert (widget->window_widgets,
+                           &window_data->id, window_data);
+      gtk_list_box_insert (GTK_LIST_BOX (widget->window_list),
+                           window_data->window_widget,
+                           position);
+    }
+}
+
+/* Rows are matched to windows by id, so that title changes and
+ * windows coming and going leave the other rows, and the selection,
+ * alone.
+ */
+static void
+update_windows_list (ScreenCastWidget *widget)
+{
+  g_autoptr(GHashTable) seen = NULL;
+  GHashTableIter iter;
+  WindowWidgetData *window_data;
+  GtkWidget *toplevel;
+  GList *windows;
   GList *l;
+  int position;
 
-  old_monitor_widgets = gtk_container_get_children (GTK_CONTAINER (monitor_list));
-  for (l = old_monitor_widgets; l; l = l->next)
+  seen = g_hash_table_new (g_int64_hash, g_int64_equal);
+
+  toplevel = gtk_widget_get_ancestor (GTK_WIDGET (widget), GTK_TYPE_WINDOW);
+
+  windows = toplevel ? shell_introspect_get_windows (widget->shell_introspect)
+                     : NULL;
+  for (l = windows, position = 0; l; l = l->next)
     {
-      GtkWidget *monitor_widget = l->data;
+      Window *window = l->data;
+      uint64_t id = window_get_id (window);
+
+      add_window_widget (widget, window, GTK_WINDOW (toplevel), position);
 
-      gtk_container_remove (GTK_CONTAINER (monitor_list), monitor_widget);
+      window_data = g_hash_table_lookup (widget->window_widgets, &id);
+      if (window_data)
+        {
+          g_hash_table_add (seen, &window_data->id);
+          position++;
+        }
     }
-  g_list_free (old_monitor_widgets);
 
-  logical_monitors =
-    display_state_tracker_get_logical_monitors (widget->display_state_tracker);
-  for (l = logical_monitors; l; l = l->next)
+  g_hash_table_iter_init (&iter, widget->window_widgets);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *)&window_data))
     {
-      LogicalMonitor *logical_monitor = l->data;
-      GtkWidget *monitor_widget;
+      GtkWidget *row;
+
+      if (g_hash_table_contains (seen, &window_data->id))
+        continue;
 
-      monitor_widget = create_monitor_widget (logical_monitor);
-      gtk_container_add (GTK_CONTAINER (monitor_list), monitor_widget);
+      row = gtk_widget_get_parent (window_data->window_widget);
+      g_hash_table_iter_remove (&iter);
+      gtk_container_remove (GTK_CONTAINER (widget->window_list), row);
     }
+
+#ifdef HAVE_WINDOW_THUMBNAILS
+  schedule_update_thumbnails (widget);
+#endif
+}
+
+static void
+add_monitor_row (ScreenCastWidget *widget,
+                 LogicalMonitor *logical_monitor,
+                 int position)
+{
+  GtkWidget *monitor_widget;
+
+  monitor_widget = create_monitor_widget (logical_monitor);
+  gtk_list_box_insert (GTK_LIST_BOX (widget->monitor_list),
+                       monitor_widget, position);
+  g_hash_table_insert (widget->monitor_rows,
+                       logical_monitor,
+                       gtk_widget_get_parent (monitor_widget));
+}
+
+static void
+update_monitors_list (ScreenCastWidget *widget)
+{
+  GPtrArray *logical_monitors;
+  guint i;
+
+  logical_monitors =
+    display_state_tracker_get_logical_monitors (widget->display_state_tracker);
+  for (i = 0; i < logical_monitors->len; i++)
+    add_monitor_row (widget, logical_monitors->pdata[i], -1);
 }
 
 static gboolean
@@ -249,9 +555,32 @@ unselect_row_cb (GtkWidget *widget,
 
 static void
 on_windows_changed (ShellIntrospect *shell_introspect,
+                    GPtrArray *added,
+                    GPtrArray *changed,
+                    GPtrArray *removed,
                     ScreenCastWidget *widget)
 {
-  update_windows_list (widget);
+  GtkWidget *toplevel;
+  guint i;
+
+  toplevel = gtk_widget_get_ancestor (GTK_WIDGET (widget), GTK_TYPE_WINDOW);
+  if (!toplevel)
+    return;
+
+  for (i = 0; i < removed->len; i++)
+    remove_window_widget (widget, window_get_id (removed->pdata[i]));
+
+  for (i = 0; i < changed->len; i++)
+    add_window_widget (widget, changed->pdata[i], GTK_WINDOW (toplevel),
+                       get_window_position (widget, changed->pdata[i]));
+
+  for (i = 0; i < added->len; i++)
+    add_window_widget (widget, added->pdata[i], GTK_WINDOW (toplevel),
+                       get_window_position (widget, added->pdata[i]));
+
+#ifdef HAVE_WINDOW_THUMBNAILS
+  schedule_update_thumbnails (widget);
+#endif
 }
 
 static void
@@ -264,6 +593,9 @@ connect_windows_changed_listener (ScreenCastWidget *widget)
                           G_CALLBACK (on_windows_changed),
                           widget);
   shell_introspect_ref_listeners (widget->shell_introspect);
+
+  /* Other listeners may have filled the window list already */
+  update_windows_list (widget);
 }
 
 static void
@@ -302,6 +634,10 @@ on_stack_switch (GtkStack *stack,
       if (widget->windows_changed_handler_id)
         disconnect_windows_changed_listener (widget);
     }
+
+#ifdef HAVE_WINDOW_THUMBNAILS
+  schedule_update_thumbnails (widget);
+#endif
 }
 
 static void
@@ -393,11 +729,57 @@ update_list_box_header (GtkListBoxRow *row,
   gtk_list_box_row_set_header (row, header);
 }
 
+/* Only touch the rows of logical monitors that changed, so that
+ * the selection survives hotplugging other monitors.
+ */
 static void
 on_monitors_changed (DisplayStateTracker *display_state_tracker,
+                     GPtrArray *added,
+                     GPtrArray *changed,
+                     GPtrArray *removed,
                      ScreenCastWidget *widget)
 {
-  update_monitors_list (widget);
+  GPtrArray *logical_monitors;
+  guint i;
+
+  for (i = 0; i < removed->len; i++)
+    {
+      GtkWidget *row = g_hash_table_lookup (widget->monitor_rows,
+                                            removed->pdata[i]);
+
+      if (!row)
+        continue;
+
+      g_hash_table_remove (widget->monitor_rows, removed->pdata[i]);
+      gtk_container_remove (GTK_CONTAINER (widget->monitor_list), row);
+    }
+
+  for (i = 0; i < changed->len; i++)
+    {
+      GtkWidget *row = g_hash_table_lookup (widget->monitor_rows,
+                                            changed->pdata[i]);
+
+      if (!row)
+        continue;
+
+      gtk_container_remove (GTK_CONTAINER (row),
+                            gtk_bin_get_child (GTK_BIN (row)));
+      gtk_container_add (GTK_CONTAINER (row),
+                         create_monitor_widget (changed->pdata[i]));
+    }
+
+  if (added->len == 0)
+    return;
+
+  logical_monitors =
+    display_state_tracker_get_logical_monitors (display_state_tracker);
+  for (i = 0; i < logical_monitors->len; i++)
+    {
+      LogicalMonitor *logical_monitor = logical_monitors->pdata[i];
+
+      if (!g_hash_table_contains (widget->monitor_rows, logical_monitor))
+        add_monitor_row (widget, logical_monitor, i);
+    }
 }
 
 static gboolean
@@ -431,14 +813,14 @@ add_selections (ScreenCastWidget *widget,
   for (l = selected_window_rows; l; l = l->next)
     {
       GtkWidget *window_widget = gtk_bin_get_child (l->data);
-      Window *window;
+      WindowWidgetData *window_data;
 
-      window = g_object_get_qdata (G_OBJECT (window_widget),
-                                    quark_window_widget_data);
+      window_data = g_object_get_qdata (G_OBJECT (window_widget),
+                                        quark_window_widget_data);
 
       g_variant_builder_add (source_selections_builder, "(ut)",
                              SCREEN_CAST_SOURCE_TYPE_WINDOW,
-                             window_get_id (window));
+                             window_data->id);
     }
   g_list_free (selected_window_rows);
 
@@ -538,6 +920,24 @@ screen_cast_widget_finalize (GObject *object)
       widget->selection_changed_timeout_id = 0;
     }
 
+#ifdef HAVE_WINDOW_THUMBNAILS
+  if (widget->update_thumbnails_id)
+    {
+      g_source_remove (widget->update_thumbnails_id);
+      widget->update_thumbnails_id = 0;
+    }
+
+  if (widget->window_thumbnailer)
+    {
+      g_signal_handler_disconnect (widget->window_thumbnailer,
+                                   widget->thumbnail_ready_handler_id);
+      g_clear_object (&widget->window_thumbnailer);
+    }
+#endif
+
+  g_hash_table_unref (widget->window_widgets);
+  g_hash_table_unref (widget->monitor_rows);
+
   G_OBJECT_CLASS (screen_cast_widget_parent_class)->finalize (object);
 }
 
@@ -561,6 +961,14 @@ screen_cast_widget_init (ScreenCastWidget *widget)
   scrolled_window = GTK_SCROLLED_WINDOW (widget->window_list_scrolled);
   vadjustment = gtk_scrolled_window_get_vadjustment (scrolled_window);
   gtk_list_box_set_adjustment (GTK_LIST_BOX (widget->window_list), vadjustment);
+#ifdef HAVE_WINDOW_THUMBNAILS
+  g_signal_connect (vadjustment, "value-changed",
+                    G_CALLBACK (on_window_list_scrolled),
+                    widget);
+  g_signal_connect (widget->window_list_scrolled, "size-allocate",
+                    G_CALLBACK (on_window_list_size_allocate),
+                    widget);
+#endif
 
   g_signal_connect (widget->source_type, "notify::visible-child",
                     G_CALLBACK (on_stack_switch),
@@ -579,12 +987,14 @@ screen_cast_widget_init (ScreenCastWidget *widget)
                     widget);
 
   widget->display_state_tracker = display_state_tracker_get ();
+  widget->monitor_rows = g_hash_table_new (NULL, NULL);
   widget->monitors_changed_handler_id =
     g_signal_connect (widget->display_state_tracker,
                       "monitors-changed",
                       G_CALLBACK (on_monitors_changed),
                       widget);
   widget->shell_introspect = shell_introspect_get ();
+  widget->window_widgets = g_hash_table_new (g_int64_hash, g_int64_equal);
 
   update_monitors_list (widget);
   update_windows_list (widget);
@@ -144,6 +144,47 @@ handle_close (XdpImplRequest *object,
   return FALSE;
 }
 
+static void
+shell_proxy_created (GObject *source_object,
+                     GAsyncResult *result,
+                     gpointer data)
+{
+  g_autoptr(GError) error = NULL;
+  OrgGnomeShellScreenshot *proxy;
+
+  proxy = org_gnome_shell_screenshot_proxy_new_finish (result, &error);
+  if (proxy == NULL)
+    {
+      g_warning ("Failed to create screenshot proxy: %s", error->message);
+      return;
+    }
+
+  if (shell == NULL)
+    shell = proxy;
+  else
+    g_object_unref (proxy);
+}
+
+static OrgGnomeShellScreenshot *
+get_shell (GDBusConnection *bus)
+{
+  g_autoptr(GError) error = NULL;
+
+  if (shell)
+    return shell;
+
+  shell = org_gnome_shell_screenshot_proxy_new_sync (bus,
+                                                     G_DBUS_PROXY_FLAGS_DO_NOT_AUTO_START,
+                                                     "org.gnome.Shell.Screenshot",
+                                                     "/org/gnome/Shell/Screenshot",
+                                                     NULL,
+                                                     &error);
+  if (shell == NULL)
+    g_warning ("Failed to create screenshot proxy: %s", error->message);
+
+  return shell;
+}
+
 static gboolean
 handle_screenshot (XdpImplScreenshot *object,
                    GDBusMethodInvocation *invocation,
@@ -159,11 +200,18 @@ handle_screenshot (XdpImplScreenshot *object,
   gboolean modal;
   gboolean interactive;
   GtkWidget *dialog;
-  GdkDisplay *display;
-  GdkScreen *screen;
   ExternalWindow *external_parent = NULL;
   GtkWidget *fake_parent;
 
+  if (get_shell (g_dbus_method_invocation_get_connection (invocation)) == NULL)
+    {
+      g_dbus_method_invocation_return_error (invocation,
+                                             XDG_DESKTOP_PORTAL_ERROR,
+                                             XDG_DESKTOP_PORTAL_ERROR_FAILED,
+                                             "Screenshots are not available");
+      return TRUE;
+    }
+
   sender = g_dbus_method_invocation_get_sender (invocation);
 
   request = request_new (sender, arg_app_id, arg_handle);
@@ -182,17 +230,7 @@ handle_screenshot (XdpImplScreenshot *object,
                    arg_parent_window);
     }
 
-  if (external_parent)
-    display = external_window_get_display (external_parent);
-  else
-    display = gdk_display_get_default ();
-  screen = gdk_display_get_default_screen (display);
-
-  fake_parent = g_object_new (GTK_TYPE_WINDOW,
-                              "type", GTK_WINDOW_TOPLEVEL,
-                              "screen", screen,
-                              NULL);
-  g_object_ref_sink (fake_parent);
+  fake_parent = get_fake_parent_for_external_window (external_parent);
 
   dialog = GTK_WIDGET (screenshot_dialog_new (arg_app_id, interactive, shell));
   gtk_window_set_transient_for (GTK_WINDOW (dialog), GTK_WINDOW (fake_parent));
@@ -262,6 +300,15 @@ handle_pick_color (XdpImplScreenshot *object,
   ScreenshotDialogHandle *handle;
   g_autoptr(GError) error = NULL;
 
+  if (get_shell (g_dbus_method_invocation_get_connection (invocation)) == NULL)
+    {
+      g_dbus_method_invocation_return_error (invocation,
+                                             XDG_DESKTOP_PORTAL_ERROR,
+                                             XDG_DESKTOP_PORTAL_ERROR_FAILED,
+                                             "Picking colors is not available");
+      return TRUE;
+    }
+
   sender = g_dbus_method_invocation_get_sender (invocation);
   request = request_new (sender, arg_app_id, arg_handle);
 
@@ -300,14 +347,16 @@ screenshot_init (GDBusConnection *bus,
                                          error))
     return FALSE;
 
-  shell = org_gnome_shell_screenshot_proxy_new_sync (bus,
-                                                     G_DBUS_PROXY_FLAGS_DO_NOT_AUTO_START,
-                                                     "org.gnome.Shell.Screenshot",
-                                                     "/org/gnome/Shell/Screenshot",
-                                                     NULL,
-                                                     error);
-  if (shell == NULL)
-    return FALSE;
+  /* Don't wait for the shell here, a request that comes in
+   * before the proxy is ready creates it right away.
+   */
+  org_gnome_shell_screenshot_proxy_new (bus,
+                                        G_DBUS_PROXY_FLAGS_DO_NOT_AUTO_START,
+                                        "org.gnome.Shell.Screenshot",
+                                        "/org/gnome/Shell/Screenshot",
+                                        NULL,
+                                        shell_proxy_created,
+                                        NULL);
 
   g_debug ("providing %s", g_dbus_interface_skeleton_get_info (helper)->name);
 
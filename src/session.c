@@ -18,6 +18,7 @@
  */
 
 #include "session.h"
+#include "utils.h"
 
 enum
 {
@@ -32,6 +33,17 @@ static GParamSpec *obj_props[PROP_LAST];
 
 static GHashTable *sessions;
 
+/* Sessions by the client they were created for, so that they can all
+ * be closed at once when the client goes away.
+ */
+typedef struct {
+  char *sender;
+  guint watcher_id;
+  GHashTable *sessions;
+} SenderSessions;
+
+static GHashTable *senders;
+
 static void session_skeleton_iface_init (XdpImplSessionIface *iface);
 
 G_DEFINE_TYPE_WITH_CODE (Session, session, XDP_IMPL_TYPE_SESSION_SKELETON,
@@ -47,6 +59,87 @@ lookup_session (const char *id)
   return g_hash_table_lookup (sessions, id);
 }
 
+static void
+sender_sessions_free (gpointer data)
+{
+  SenderSessions *sender_sessions = data;
+
+  unwatch_sender (sender_sessions->watcher_id);
+  g_hash_table_unref (sender_sessions->sessions);
+  g_free (sender_sessions->sender);
+
+  g_free (sender_sessions);
+}
+
+static void
+close_sessions_for_sender (const char *sender,
+                           gpointer user_data)
+{
+  SenderSessions *sender_sessions = user_data;
+  GList *to_close, *l;
+
+  g_debug ("%s went away, closing %u sessions", sender,
+           g_hash_table_size (sender_sessions->sessions));
+
+  /* Closing a session removes it from sender_sessions, and the
+   * last one frees it.
+   */
+  to_close = g_hash_table_get_keys (sender_sessions->sessions);
+  g_list_foreach (to_close, (GFunc) g_object_ref, NULL);
+
+  for (l = to_close; l; l = l->next)
+    {
+      Session *session = l->data;
+
+      if (!session->closed)
+        session_close (session);
+    }
+
+  g_list_free_full (to_close, g_object_unref);
+}
+
+static void
+add_sender_session (Session *session,
+                    GDBusConnection *connection)
+{
+  SenderSessions *sender_sessions;
+
+  if (session->sender == NULL)
+    return;
+
+  sender_sessions = g_hash_table_lookup (senders, session->sender);
+  if (sender_sessions == NULL)
+    {
+      sender_sessions = g_new0 (SenderSessions, 1);
+      sender_sessions->sender = g_strdup (session->sender);
+      sender_sessions->sessions = g_hash_table_new (NULL, NULL);
+      sender_sessions->watcher_id = watch_sender (connection,
+                                                  session->sender,
+                                                  close_sessions_for_sender,
+                                                  sender_sessions);
+      g_hash_table_insert (senders, sender_sessions->sender, sender_sessions);
+    }
+
+  g_hash_table_add (sender_sessions->sessions, session);
+}
+
+static void
+remove_sender_session (Session *session)
+{
+  SenderSessions *sender_sessions;
+
+  if (session->sender == NULL)
+    return;
+
+  sender_sessions = g_hash_table_lookup (senders, session->sender);
+  if (sender_sessions == NULL)
+    return;
+
+  if (g_hash_table_remove (sender_sessions->sessions, session) &&
+      g_hash_table_size (sender_sessions->sessions) == 0)
+    g_hash_table_remove (senders, session->sender);
+}
+
 gboolean
 session_export (Session *session,
                 GDBusConnection *connection,
@@ -61,6 +154,8 @@ session_export (Session *session,
   g_object_ref (session);
   session->exported = TRUE;
 
+  add_sender_session (session, connection);
+
   return TRUE;
 }
 
@@ -80,6 +175,8 @@ session_close (Session *session)
 
   session->closed = TRUE;
 
+  remove_sender_session (session);
+
   SESSION_GET_CLASS (session)->close (session);
 
   g_object_unref (session);
@@ -149,8 +246,10 @@ session_finalize (GObject *object)
   Session *session = (Session *)object;
 
   g_hash_table_remove (sessions, session->id);
+  remove_sender_session (session);
 
   g_free (session->id);
+  g_free (session->sender);
 
   G_OBJECT_CLASS (session_parent_class)->finalize (object);
 }
@@ -161,6 +260,7 @@ session_constructed (GObject *object)
   Session *session = (Session *)object;
 
   g_hash_table_insert (sessions, g_strdup (session->id), session);
+  session->sender = get_sender_from_handle (session->id);
 
   G_OBJECT_CLASS (session_parent_class)->constructed (object);
 }
@@ -192,4 +292,6 @@ session_class_init (SessionClass *klass)
 
   sessions = g_hash_table_new_full (g_str_hash, g_str_equal,
                                     g_free, NULL);
+  senders = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                   NULL, sender_sessions_free);
 }
@@ -30,6 +30,7 @@ struct _Session
   gboolean exported;
   gboolean closed;
   char *id;
+  char *sender;
 };
 
 struct _SessionClass
@@ -48,6 +48,11 @@ struct _ShellIntrospect
   OrgGnomeShellIntrospect *proxy;
 
   GList *windows;
+  GHashTable *windows_by_id;
+
+  gboolean fetching_windows;
+  gboolean windows_outdated;
+  guint sync_timeout_id;
 
   int num_listeners;
 };
@@ -56,6 +61,13 @@ G_DEFINE_TYPE (ShellIntrospect, shell_introspect, G_TYPE_OBJECT)
 
 static ShellIntrospect *_shell_introspect;
 
+/* Changes tend to come in bursts, e.g. while a terminal updates its
+ * title, so wait a little before fetching the window list.
+ */
+#define SYNC_DELAY_MS 100
+
+static void sync_state (ShellIntrospect *shell_introspect);
+
 static void
 window_free (Window *window)
 {
@@ -82,6 +94,43 @@ window_get_id (Window *window)
   return window->id;
 }
 
+static void
+clear_windows (ShellIntrospect *shell_introspect)
+{
+  g_hash_table_remove_all (shell_introspect->windows_by_id);
+  g_list_free_full (shell_introspect->windows, (GDestroyNotify) window_free);
+  shell_introspect->windows = NULL;
+}
+
+/* Returns TRUE if the window changed */
+static gboolean
+update_window (Window *window,
+               GVariant *params)
+{
+  g_autofree char *app_id = NULL;
+  g_autofree char *title = NULL;
+  gboolean changed = FALSE;
+
+  g_variant_lookup (params, "app-id", "s", &app_id);
+  g_variant_lookup (params, "title", "s", &title);
+
+  if (g_strcmp0 (window->app_id, app_id) != 0)
+    {
+      g_free (window->app_id);
+      window->app_id = g_steal_pointer (&app_id);
+      changed = TRUE;
+    }
+
+  if (g_strcmp0 (window->title, title) != 0)
+    {
+      g_free (window->title);
+      window->title = g_steal_pointer (&title);
+      changed = TRUE;
+    }
+
+  return changed;
+}
+
 static void
 get_windows_cb (GObject *source_object,
                 GAsyncResult *res,
@@ -90,59 +139,132 @@ get_windows_cb (GObject *source_object,
   ShellIntrospect *shell_introspect = user_data;
   g_autoptr(GVariant) windows_variant = NULL;
   g_autoptr(GError) error = NULL;
+  g_autoptr(GPtrArray) added = NULL;
+  g_autoptr(GPtrArray) changed = NULL;
+  g_autoptr(GPtrArray) removed = NULL;
+  g_autoptr(GHashTable) seen = NULL;
   GVariantIter iter;
   uint64_t id;
   GVariant *params = NULL;
   GList *windows = NULL;
+  GList *l;
 
-  g_list_free_full (shell_introspect->windows, (GDestroyNotify) window_free);
-  shell_introspect->windows = NULL;
+  shell_introspect->fetching_windows = FALSE;
 
-  if (!org_gnome_shell_introspect_call_get_windows_finish (shell_introspect->proxy,
+  if (!org_gnome_shell_introspect_call_get_windows_finish (ORG_GNOME_SHELL_INTROSPECT (source_object),
                                                            &windows_variant,
                                                            res,
                                                            &error))
     {
-      g_warning ("Failed to get window list: %s", error->message);
+      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        g_warning ("Failed to get window list: %s", error->message);
       return;
     }
 
+  /* The last listener went away while we were fetching */
+  if (shell_introspect->num_listeners == 0)
+    return;
+
+  added = g_ptr_array_new ();
+  changed = g_ptr_array_new ();
+  removed = g_ptr_array_new_with_free_func ((GDestroyNotify) window_free);
+  seen = g_hash_table_new (g_int64_hash, g_int64_equal);
+
   g_variant_iter_init (&iter, windows_variant);
   while (g_variant_iter_loop (&iter, "{t@a{sv}}", &id, &params))
     {
-      char *app_id = NULL;
-      char *title = NULL;
-      unsigned int time_since_user_time = UINT_MAX;
       Window *window;
 
-      g_variant_lookup (params, "app-id", "s", &app_id);
-      g_variant_lookup (params, "title", "s", &title);
-      g_variant_lookup (params, "time-since-user-time", "u", &time_since_user_time);
-
-      window = g_new0 (Window, 1);
-      *window = (Window) {
-        .id = id,
-        .title = title,
-        .app_id = app_id
-      };
+      window = g_hash_table_lookup (shell_introspect->windows_by_id, &id);
+      if (window == NULL)
+        {
+          window = g_new0 (Window, 1);
+          window->id = id;
+          update_window (window, params);
+
+          g_hash_table_insert (shell_introspect->windows_by_id,
+                               &window->id, window);
+          g_ptr_array_add (added, window);
+        }
+      else if (update_window (window, params))
+        {
+          g_ptr_array_add (changed, window);
+        }
+
+      g_hash_table_add (seen, &window->id);
+
+      /* Keep the windows in the order the shell lists them */
       windows = g_list_prepend (windows, window);
+    }
 
-      g_clear_pointer (&params, g_variant_unref);
+  for (l = shell_introspect->windows; l; l = l->next)
+    {
+      Window *window = l->data;
+
+      if (!g_hash_table_contains (seen, &window->id))
+        {
+          g_hash_table_remove (shell_introspect->windows_by_id, &window->id);
+          g_ptr_array_add (removed, window);
+        }
     }
 
+  g_list_free (shell_introspect->windows);
   shell_introspect->windows = windows;
-  g_signal_emit (shell_introspect, signals[WINDOWS_CHANGED], 0);
+
+  if (added->len > 0 || changed->len > 0 || removed->len > 0)
+    g_signal_emit (shell_introspect, signals[WINDOWS_CHANGED], 0,
+                   added, changed, removed);
+
+  /* More changes came in while we were fetching */
+  if (shell_introspect->windows_outdated)
+    sync_state (shell_introspect);
 }
 
 static void
-sync_state (ShellIntrospect *shell_introspect)
+fetch_windows (ShellIntrospect *shell_introspect)
 {
+  shell_introspect->windows_outdated = FALSE;
+  shell_introspect->fetching_windows = TRUE;
   org_gnome_shell_introspect_call_get_windows (shell_introspect->proxy,
                                                shell_introspect->cancellable,
                                                get_windows_cb,
                                                shell_introspect);
 }
 
+static gboolean
+sync_timeout_cb (gpointer data)
+{
+  ShellIntrospect *shell_introspect = data;
+
+  shell_introspect->sync_timeout_id = 0;
+
+  if (shell_introspect->proxy && shell_introspect->num_listeners > 0)
+    fetch_windows (shell_introspect);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+sync_state (ShellIntrospect *shell_introspect)
+{
+  shell_introspect->windows_outdated = TRUE;
+
+  if (shell_introspect->fetching_windows ||
+      shell_introspect->sync_timeout_id != 0)
+    return;
+
+  shell_introspect->sync_timeout_id =
+    g_timeout_add (SYNC_DELAY_MS, sync_timeout_cb, shell_introspect);
+}
+
+static void
+on_windows_changed (OrgGnomeShellIntrospect *proxy,
+                    ShellIntrospect *shell_introspect)
+{
+  if (shell_introspect->num_listeners > 0)
+    sync_state (shell_introspect);
+}
+
 GList *
 shell_introspect_get_windows (ShellIntrospect *shell_introspect)
 {
@@ -154,8 +276,18 @@ shell_introspect_ref_listeners (ShellIntrospect *shell_introspect)
 {
   shell_introspect->num_listeners++;
 
-  if (shell_introspect->proxy)
-    sync_state (shell_introspect);
+  if (shell_introspect->proxy && shell_introspect->num_listeners == 1)
+    {
+      if (shell_introspect->sync_timeout_id)
+        {
+          g_source_remove (shell_introspect->sync_timeout_id);
+          shell_introspect->sync_timeout_id = 0;
+        }
+      if (shell_introspect->fetching_windows)
+        shell_introspect->windows_outdated = TRUE;
+      else
+        fetch_windows (shell_introspect);
+    }
 }
 
 void
@@ -166,9 +298,13 @@ shell_introspect_unref_listeners (ShellIntrospect *shell_introspect)
   shell_introspect->num_listeners--;
   if (shell_introspect->num_listeners == 0)
     {
-      g_list_free_full (shell_introspect->windows,
-                        (GDestroyNotify) window_free);
-      shell_introspect->windows = NULL;
+      if (shell_introspect->sync_timeout_id)
+        {
+          g_source_remove (shell_introspect->sync_timeout_id);
+          shell_introspect->sync_timeout_id = 0;
+        }
+      shell_introspect->windows_outdated = FALSE;
+      clear_windows (shell_introspect);
     }
 }
 
@@ -190,10 +326,21 @@ on_shell_introspect_proxy_acquired (GObject      *object,
       return;
     }
 
+  if (shell_introspect->proxy)
+    {
+      g_signal_handlers_disconnect_by_data (shell_introspect->proxy,
+                                            shell_introspect);
+      g_object_unref (shell_introspect->proxy);
+    }
+
   shell_introspect->proxy = proxy;
+  g_signal_connect (proxy, "windows-changed",
+                    G_CALLBACK (on_windows_changed), shell_introspect);
+  g_signal_connect (proxy, "running-applications-changed",
+                    G_CALLBACK (on_windows_changed), shell_introspect);
 
   if (shell_introspect->num_listeners > 0)
-    sync_state (shell_introspect);
+    fetch_windows (shell_introspect);
 }
 
 static void
@@ -250,6 +397,8 @@ shell_introspect_get (void)
 static void
 shell_introspect_init (ShellIntrospect *shell_introspect)
 {
+  shell_introspect->windows_by_id = g_hash_table_new (g_int64_hash,
+                                                      g_int64_equal);
 }
 
 static void
@@ -260,5 +409,8 @@ shell_introspect_class_init (ShellIntrospectClass *klass)
                                            G_SIGNAL_RUN_LAST,
                                            0,
                                            NULL, NULL, NULL,
-                                           G_TYPE_NONE, 0);
+                                           G_TYPE_NONE, 3,
+                                           G_TYPE_PTR_ARRAY,
+                                           G_TYPE_PTR_ARRAY,
+                                           G_TYPE_PTR_ARRAY);
 }
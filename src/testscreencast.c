@@ -0,0 +1,46 @@
+#include <gtk/gtk.h>
+#include "screencastdialog.h"
+
+/* Shows the window picker of the screen cast dialog. Run mockscreencast
+ * first to get fake windows with thumbnails.
+ */
+
+static void
+done_cb (ScreenCastDialog *dialog,
+         int response,
+         GVariant *selections,
+         gpointer data)
+{
+        if (response == GTK_RESPONSE_OK && selections)
+                g_print ("%s\n", g_variant_print (selections, FALSE));
+        else
+                g_print ("canceled\n");
+
+        gtk_main_quit ();
+}
+
+int
+main (int argc, char *argv[])
+{
+        ScreenCastDialog *dialog;
+        ScreenCastSelection select = {
+                .multiple = FALSE,
+                .source_types = SCREEN_CAST_SOURCE_TYPE_WINDOW,
+        };
+        const char *app_id = NULL;
+        GOptionEntry entries[] = {
+          { "app-id", 0, 0, G_OPTION_ARG_STRING, &app_id, "The requesting application", "ID" },
+          { NULL, }
+        };
+
+        gtk_init_with_args (&argc, &argv, NULL, entries, NULL, NULL);
+
+        dialog = screen_cast_dialog_new (app_id, &select);
+        g_signal_connect (dialog, "done", G_CALLBACK (done_cb), NULL);
+
+        gtk_widget_show (GTK_WIDGET (dialog));
+
+        gtk_main ();
+
+        return 0;
+}
@@ -0,0 +1,99 @@
+/*
+ * Copyright © 2026 xdg-desktop-portal-gtk contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "config.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdarg.h>
+#include <string.h>
+#include <unistd.h>
+
+#ifdef HAVE_SYSPROF
+#include <sysprof-capture.h>
+#endif
+
+#include "trace.h"
+
+/* Marks go to sysprof when we are built with sysprof-capture and run
+ * under the profiler. Setting XDG_DESKTOP_PORTAL_GTK_TRACE also writes
+ * them to the ftrace marker, so they show up in perf and trace-cmd
+ * recordings, interleaved with the kernel events.
+ */
+
+#define TRACE_GROUP "xdg-desktop-portal-gtk"
+
+static int trace_marker_fd = -1;
+
+void
+trace_init (void)
+{
+  const char *paths[] = {
+    "/sys/kernel/tracing/trace_marker",
+    "/sys/kernel/debug/tracing/trace_marker",
+  };
+  gsize i;
+
+#ifdef HAVE_SYSPROF
+  sysprof_collector_init ();
+#endif
+
+  if (g_getenv ("XDG_DESKTOP_PORTAL_GTK_TRACE") == NULL)
+    return;
+
+  for (i = 0; i < G_N_ELEMENTS (paths) && trace_marker_fd == -1; i++)
+    trace_marker_fd = open (paths[i], O_WRONLY | O_CLOEXEC);
+
+  if (trace_marker_fd == -1)
+    g_warning ("Failed to open the ftrace marker: %s", g_strerror (errno));
+}
+
+void
+trace_mark (gint64 begin_time,
+            gint64 duration,
+            const char *name,
+            const char *message_format,
+            ...)
+{
+  va_list args;
+
+#ifdef HAVE_SYSPROF
+  va_start (args, message_format);
+  sysprof_collector_mark_vprintf (begin_time, duration, TRACE_GROUP, name, message_format, args);
+  va_end (args);
+#endif
+
+  if (trace_marker_fd != -1)
+    {
+      g_autofree char *message = NULL;
+      g_autofree char *line = NULL;
+      gsize len;
+
+      va_start (args, message_format);
+      message = g_strdup_vprintf (message_format, args);
+      va_end (args);
+
+      /* One write, so the line isn't split up in the ring buffer */
+      line = g_strdup_printf (TRACE_GROUP ": %s: begin=%" G_GINT64_FORMAT
+                              " duration=%" G_GINT64_FORMAT " %s\n",
+                              name, begin_time, duration, message);
+      len = strlen (line);
+      if (write (trace_marker_fd, line, len) != (gssize) len)
+        g_debug ("Failed to write trace mark: %s", g_strerror (errno));
+    }
+}
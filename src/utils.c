@@ -20,6 +20,8 @@
 
 #include "config.h"
 
+#include <string.h>
+
 #include <gio/gio.h>
 
 #include "utils.h"
@@ -45,3 +47,159 @@ xdg_desktop_portal_error_quark (void)
                                       G_N_ELEMENTS (xdg_desktop_portal_error_entries));
   return (GQuark) quark_volatile;
 }
+
+/* Request and session handles look like
+ * /org/freedesktop/portal/desktop/session/1_42/token, with the
+ * unique name of the client, :1.42, escaped.
+ */
+char *
+get_sender_from_handle (const char *handle)
+{
+  const char *prefixes[] = {
+    DESKTOP_PORTAL_OBJECT_PATH "/request/",
+    DESKTOP_PORTAL_OBJECT_PATH "/session/",
+  };
+  gsize i;
+
+  for (i = 0; i < G_N_ELEMENTS (prefixes); i++)
+    {
+      const char *start;
+      const char *end;
+      char *sender;
+
+      if (!g_str_has_prefix (handle, prefixes[i]))
+        continue;
+
+      start = handle + strlen (prefixes[i]);
+      end = strchr (start, '/');
+      if (end == NULL || end == start)
+        return NULL;
+
+      sender = g_strdup_printf (":%.*s", (int) (end - start), start);
+      g_strdelimit (sender, "_", '.');
+
+      return sender;
+    }
+
+  return NULL;
+}
+
+/* Requests and sessions both need to know when their client goes
+ * away. They share one name watch per client, with a watcher for each
+ * interested party.
+ */
+typedef struct {
+  char *sender;
+  guint watch_id;
+  GList *watchers;
+} SenderWatch;
+
+typedef struct {
+  guint id;
+  SenderWatch *watch;
+  SenderVanishedCallback callback;
+  gpointer user_data;
+} SenderWatcher;
+
+static GHashTable *sender_watches;
+static GHashTable *sender_watchers;
+static guint next_watcher_id = 1;
+
+static void
+sender_vanished (GDBusConnection *connection,
+                 const char *name,
+                 gpointer user_data)
+{
+  SenderWatch *watch = user_data;
+  g_autofree char *sender = g_strdup (watch->sender);
+  g_autoptr(GArray) ids = NULL;
+  GList *l;
+  guint i;
+
+  /* Watchers usually unwatch when called, which can free the watch */
+  ids = g_array_new (FALSE, FALSE, sizeof (guint));
+  for (l = watch->watchers; l; l = l->next)
+    {
+      SenderWatcher *watcher = l->data;
+
+      g_array_append_val (ids, watcher->id);
+    }
+
+  for (i = 0; i < ids->len; i++)
+    {
+      SenderWatcher *watcher;
+
+      watcher = g_hash_table_lookup (sender_watchers,
+                                     GUINT_TO_POINTER (g_array_index (ids, guint, i)));
+      if (watcher)
+        watcher->callback (sender, watcher->user_data);
+    }
+}
+
+guint
+watch_sender (GDBusConnection *connection,
+              const char *sender,
+              SenderVanishedCallback callback,
+              gpointer user_data)
+{
+  SenderWatch *watch;
+  SenderWatcher *watcher;
+
+  if (sender_watches == NULL)
+    {
+      sender_watches = g_hash_table_new (g_str_hash, g_str_equal);
+      sender_watchers = g_hash_table_new (NULL, NULL);
+    }
+
+  watch = g_hash_table_lookup (sender_watches, sender);
+  if (watch == NULL)
+    {
+      watch = g_new0 (SenderWatch, 1);
+      watch->sender = g_strdup (sender);
+      g_hash_table_insert (sender_watches, watch->sender, watch);
+
+      /* This also tells us if the client is already gone */
+      watch->watch_id = g_bus_watch_name_on_connection (connection,
+                                                        sender,
+                                                        G_BUS_NAME_WATCHER_FLAGS_NONE,
+                                                        NULL,
+                                                        sender_vanished,
+                                                        watch,
+                                                        NULL);
+    }
+
+  watcher = g_new0 (SenderWatcher, 1);
+  watcher->id = next_watcher_id++;
+  watcher->watch = watch;
+  watcher->callback = callback;
+  watcher->user_data = user_data;
+
+  watch->watchers = g_list_prepend (watch->watchers, watcher);
+  g_hash_table_insert (sender_watchers, GUINT_TO_POINTER (watcher->id), watcher);
+
+  return watcher->id;
+}
+
+void
+unwatch_sender (guint watcher_id)
+{
+  SenderWatcher *watcher;
+  SenderWatch *watch;
+
+  watcher = g_hash_table_lookup (sender_watchers, GUINT_TO_POINTER (watcher_id));
+  g_return_if_fail (watcher != NULL);
+
+  g_hash_table_remove (sender_watchers, GUINT_TO_POINTER (watcher_id));
+
+  watch = watcher->watch;
+  watch->watchers = g_list_remove (watch->watchers, watcher);
+  g_free (watcher);
+
+  if (watch->watchers == NULL)
+    {
+      g_hash_table_remove (sender_watches, watch->sender);
+      g_bus_unwatch_name (watch->watch_id);
+      g_free (watch->sender);
+      g_free (watch);
+    }
+}
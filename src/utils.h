@@ -37,3 +37,14 @@ typedef enum {
 #define XDG_DESKTOP_PORTAL_ERROR xdg_desktop_portal_error_quark ()
 
 GQuark  xdg_desktop_portal_error_quark (void);
+
+char *get_sender_from_handle (const char *handle);
+
+typedef void (* SenderVanishedCallback) (const char *sender,
+                                         gpointer user_data);
+
+guint watch_sender (GDBusConnection *connection,
+                    const char *sender,
+                    SenderVanishedCallback callback,
+                    gpointer user_data);
+void unwatch_sender (guint watcher_id);
@@ -0,0 +1,931 @@
+/*
+ * Copyright © 2026 xdg-desktop-portal-gtk contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "config.h"
+
+#include <pipewire/pipewire.h>
+#include <spa/param/video/format-utils.h>
+
+#include "windowthumbnailer.h"
+#include "shell-dbus.h"
+
+/* Thumbnails are taken by screen casting each window through mutter
+ * until the first frame arrives, so every capture costs mutter a
+ * session and a frame copy. Captures are therefore limited in
+ * number, and the refresh interval grows with the number of windows
+ * so that capturing stays within a small share of the time.
+ */
+#define MAX_CAPTURES 2
+#define MAX_WINDOWS 12
+#define CAPTURE_TIMEOUT_MS 3000
+#define MIN_REFRESH_INTERVAL_US (2 * G_USEC_PER_SEC)
+#define CAPTURE_TIME_BUDGET 0.05
+
+/* Each thumbnail pixel averages at most this many source pixels per
+ * axis, which is plenty for 160x100 and keeps large windows cheap.
+ */
+#define MAX_SAMPLES 4
+
+enum
+{
+  THUMBNAIL_READY,
+
+  N_SIGNALS
+};
+
+static guint signals[N_SIGNALS];
+
+typedef struct _Capture Capture;
+
+struct _WindowThumbnailer
+{
+  GObject parent;
+
+  GCancellable *cancellable;
+  OrgGnomeMutterScreenCast *proxy;
+
+  struct pw_thread_loop *pw_loop;
+  struct pw_context *pw_context;
+  struct pw_core *pw_core;
+
+  GArray *window_ids;
+  GHashTable *capture_times;
+  GList *captures;
+  guint n_captures;
+  guint refresh_timeout_id;
+
+  gint64 capture_cost;
+};
+
+typedef struct
+{
+  uint64_t window_id;
+  gint64 time;
+} CaptureTime;
+
+/* Captures are shared with the PipeWire thread, which takes a
+ * reference for every frame it hands back to the main thread.
+ * The thumbnailer pointer is cleared once the capture is done.
+ */
+struct _Capture
+{
+  int ref_count;
+
+  WindowThumbnailer *thumbnailer;
+  uint64_t window_id;
+  gint64 start_time;
+
+  GCancellable *cancellable;
+  OrgGnomeMutterScreenCastSession *session_proxy;
+  OrgGnomeMutterScreenCastStream *stream_proxy;
+  gulong stream_added_handler_id;
+  guint timeout_id;
+
+  struct pw_stream *pw_stream;
+  struct spa_hook stream_listener;
+  struct spa_video_info_raw format;
+  GdkPixbuf *pixbuf;
+};
+
+G_DEFINE_TYPE (WindowThumbnailer, window_thumbnailer, G_TYPE_OBJECT)
+
+static void schedule_captures (WindowThumbnailer *thumbnailer);
+
+static Capture *
+capture_ref (Capture *capture)
+{
+  g_atomic_int_inc (&capture->ref_count);
+  return capture;
+}
+
+static void
+capture_unref (Capture *capture)
+{
+  if (!g_atomic_int_dec_and_test (&capture->ref_count))
+    return;
+
+  g_clear_object (&capture->pixbuf);
+  g_clear_object (&capture->stream_proxy);
+  g_clear_object (&capture->session_proxy);
+  g_clear_object (&capture->cancellable);
+  g_free (capture);
+}
+
+static gboolean
+is_capturing (WindowThumbnailer *thumbnailer,
+              uint64_t window_id)
+{
+  GList *l;
+
+  for (l = thumbnailer->captures; l; l = l->next)
+    {
+      Capture *capture = l->data;
+
+      if (capture->window_id == window_id)
+        return TRUE;
+    }
+
+  return FALSE;
+}
+
+static void
+finish_capture (Capture *capture,
+                GdkPixbuf *pixbuf)
+{
+  WindowThumbnailer *thumbnailer = capture->thumbnailer;
+  CaptureTime *capture_time;
+  gint64 now;
+
+  g_cancellable_cancel (capture->cancellable);
+
+  if (capture->timeout_id)
+    {
+      g_source_remove (capture->timeout_id);
+      capture->timeout_id = 0;
+    }
+
+  if (capture->stream_added_handler_id)
+    {
+      g_signal_handler_disconnect (capture->stream_proxy,
+                                   capture->stream_added_handler_id);
+      capture->stream_added_handler_id = 0;
+    }
+
+  if (capture->pw_stream)
+    {
+      pw_thread_loop_lock (thumbnailer->pw_loop);
+      spa_hook_remove (&capture->stream_listener);
+      pw_stream_destroy (capture->pw_stream);
+      capture->pw_stream = NULL;
+      pw_thread_loop_unlock (thumbnailer->pw_loop);
+    }
+
+  if (capture->session_proxy)
+    org_gnome_mutter_screen_cast_session_call_stop (capture->session_proxy,
+                                                    NULL, NULL, NULL);
+
+  now = g_get_monotonic_time ();
+  if (pixbuf)
+    {
+      gint64 cost = now - capture->start_time;
+
+      if (thumbnailer->capture_cost)
+        thumbnailer->capture_cost = (3 * thumbnailer->capture_cost + cost) / 4;
+      else
+        thumbnailer->capture_cost = cost;
+    }
+
+  /* Windows that failed are not retried any sooner than the others. */
+  capture_time = g_new0 (CaptureTime, 1);
+  capture_time->window_id = capture->window_id;
+  capture_time->time = now;
+  g_hash_table_replace (thumbnailer->capture_times,
+                        &capture_time->window_id, capture_time);
+
+  thumbnailer->captures = g_list_remove (thumbnailer->captures, capture);
+  thumbnailer->n_captures--;
+  capture->thumbnailer = NULL;
+
+  if (pixbuf)
+    g_signal_emit (thumbnailer, signals[THUMBNAIL_READY], 0,
+                   capture->window_id, pixbuf);
+
+  capture_unref (capture);
+
+  schedule_captures (thumbnailer);
+}
+
+static void
+fail_capture (Capture *capture,
+              const char *what,
+              GError *error)
+{
+  if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+    return;
+
+  g_debug ("Failed to capture window %" G_GUINT64_FORMAT ": %s: %s",
+           capture->window_id, what, error->message);
+  finish_capture (capture, NULL);
+}
+
+static void
+get_thumbnail_size (int width,
+                    int height,
+                    int *thumbnail_width,
+                    int *thumbnail_height)
+{
+  if (width * WINDOW_THUMBNAIL_HEIGHT > height * WINDOW_THUMBNAIL_WIDTH)
+    {
+      *thumbnail_width = MIN (width, WINDOW_THUMBNAIL_WIDTH);
+      *thumbnail_height = MAX (1, height * *thumbnail_width / width);
+    }
+  else
+    {
+      *thumbnail_height = MIN (height, WINDOW_THUMBNAIL_HEIGHT);
+      *thumbnail_width = MAX (1, width * *thumbnail_height / height);
+    }
+}
+
+/* Box filter over a few evenly spaced samples per thumbnail pixel.
+ * Frames are 32 bits per pixel, red first for RGBx/RGBA and blue
+ * first for BGRx/BGRA.
+ */
+static GdkPixbuf *
+scale_frame (const uint8_t *data,
+             int width,
+             int height,
+             int stride,
+             gboolean red_first)
+{
+  GdkPixbuf *pixbuf;
+  uint8_t *pixels;
+  int rowstride;
+  int thumbnail_width;
+  int thumbnail_height;
+  int x, y;
+
+  get_thumbnail_size (width, height, &thumbnail_width, &thumbnail_height);
+
+  pixbuf = gdk_pixbuf_new (GDK_COLORSPACE_RGB, FALSE, 8,
+                           thumbnail_width, thumbnail_height);
+  if (!pixbuf)
+    return NULL;
+
+  pixels = gdk_pixbuf_get_pixels (pixbuf);
+  rowstride = gdk_pixbuf_get_rowstride (pixbuf);
+
+  for (y = 0; y < thumbnail_height; y++)
+    {
+      int y0 = y * height / thumbnail_height;
+      int y1 = MAX (y0 + 1, (y + 1) * height / thumbnail_height);
+      int y_step = MAX (1, (y1 - y0) / MAX_SAMPLES);
+      uint8_t *out = pixels + y * rowstride;
+
+      for (x = 0; x < thumbnail_width; x++)
+        {
+          int x0 = x * width / thumbnail_width;
+          int x1 = MAX (x0 + 1, (x + 1) * width / thumbnail_width);
+          int x_step = MAX (1, (x1 - x0) / MAX_SAMPLES);
+          unsigned int r = 0, g = 0, b = 0, n = 0;
+          int sx, sy;
+
+          for (sy = y0; sy < y1; sy += y_step)
+            {
+              const uint8_t *row = data + (size_t) sy * stride;
+
+              for (sx = x0; sx < x1; sx += x_step)
+                {
+                  const uint8_t *p = row + sx * 4;
+
+                  r += p[red_first ? 0 : 2];
+                  g += p[1];
+                  b += p[red_first ? 2 : 0];
+                  n++;
+                }
+            }
+
+          out[0] = r / n;
+          out[1] = g / n;
+          out[2] = b / n;
+          out += 3;
+        }
+    }
+
+  return pixbuf;
+}
+
+static gboolean
+frame_ready_idle (gpointer user_data)
+{
+  Capture *capture = user_data;
+  WindowThumbnailer *thumbnailer = capture->thumbnailer;
+  g_autoptr(GdkPixbuf) pixbuf = NULL;
+
+  if (thumbnailer)
+    {
+      pw_thread_loop_lock (thumbnailer->pw_loop);
+      pixbuf = g_steal_pointer (&capture->pixbuf);
+      pw_thread_loop_unlock (thumbnailer->pw_loop);
+
+      finish_capture (capture, pixbuf);
+    }
+
+  capture_unref (capture);
+  return G_SOURCE_REMOVE;
+}
+
+/* Runs in the PipeWire thread, with the thread loop locked. */
+static void
+on_stream_process (void *user_data)
+{
+  Capture *capture = user_data;
+  struct pw_buffer *buffer;
+  struct spa_data *spa_data;
+  int width = capture->format.size.width;
+  int height = capture->format.size.height;
+  int stride;
+
+  buffer = pw_stream_dequeue_buffer (capture->pw_stream);
+  if (!buffer)
+    return;
+
+  spa_data = &buffer->buffer->datas[0];
+  stride = spa_data->chunk->stride ? spa_data->chunk->stride : width * 4;
+  if (capture->pixbuf == NULL &&
+      spa_data->data != NULL &&
+      spa_data->chunk->size > 0 &&
+      width > 0 && height > 0 && stride >= width * 4 &&
+      spa_data->chunk->offset + (uint64_t) stride * height <= spa_data->maxsize)
+    {
+      capture->pixbuf =
+        scale_frame ((uint8_t *) spa_data->data + spa_data->chunk->offset,
+                     width, height, stride,
+                     capture->format.format == SPA_VIDEO_FORMAT_RGBx ||
+                     capture->format.format == SPA_VIDEO_FORMAT_RGBA);
+      if (capture->pixbuf)
+        g_idle_add (frame_ready_idle, capture_ref (capture));
+    }
+
+  pw_stream_queue_buffer (capture->pw_stream, buffer);
+}
+
+/* Runs in the PipeWire thread, with the thread loop locked. */
+static void
+on_stream_param_changed (void *user_data,
+                         uint32_t id,
+                         const struct spa_pod *param)
+{
+  Capture *capture = user_data;
+  uint8_t params_buffer[1024];
+  struct spa_pod_builder builder =
+    SPA_POD_BUILDER_INIT (params_buffer, sizeof (params_buffer));
+  const struct spa_pod *params[1];
+  uint32_t media_type;
+  uint32_t media_subtype;
+
+  if (param == NULL || id != SPA_PARAM_Format)
+    return;
+
+  if (spa_format_parse (param, &media_type, &media_subtype) < 0 ||
+      media_type != SPA_MEDIA_TYPE_video ||
+      media_subtype != SPA_MEDIA_SUBTYPE_raw)
+    return;
+
+  if (spa_format_video_raw_parse (param, &capture->format) < 0)
+    return;
+
+  params[0] = spa_pod_builder_add_object (
+    &builder,
+    SPA_TYPE_OBJECT_ParamBuffers, SPA_PARAM_Buffers,
+    SPA_PARAM_BUFFERS_dataType, SPA_POD_CHOICE_FLAGS_Int ((1 << SPA_DATA_MemFd) |
+                                                          (1 << SPA_DATA_MemPtr)));
+  pw_stream_update_params (capture->pw_stream, params, 1);
+}
+
+static const struct pw_stream_events stream_events = {
+  PW_VERSION_STREAM_EVENTS,
+  .param_changed = on_stream_param_changed,
+  .process = on_stream_process,
+};
+
+static void
+on_pipewire_stream_added (OrgGnomeMutterScreenCastStream *stream_proxy,
+                          unsigned int node_id,
+                          Capture *capture)
+{
+  WindowThumbnailer *thumbnailer = capture->thumbnailer;
+  uint8_t params_buffer[1024];
+  struct spa_pod_builder builder =
+    SPA_POD_BUILDER_INIT (params_buffer, sizeof (params_buffer));
+  const struct spa_pod *params[1];
+
+  if (capture->pw_stream)
+    return;
+
+  params[0] = spa_pod_builder_add_object (
+    &builder,
+    SPA_TYPE_OBJECT_Format, SPA_PARAM_EnumFormat,
+    SPA_FORMAT_mediaType, SPA_POD_Id (SPA_MEDIA_TYPE_video),
+    SPA_FORMAT_mediaSubtype, SPA_POD_Id (SPA_MEDIA_SUBTYPE_raw),
+    SPA_FORMAT_VIDEO_format, SPA_POD_CHOICE_ENUM_Id (5,
+                                                     SPA_VIDEO_FORMAT_BGRx,
+                                                     SPA_VIDEO_FORMAT_BGRx,
+                                                     SPA_VIDEO_FORMAT_RGBx,
+                                                     SPA_VIDEO_FORMAT_BGRA,
+                                                     SPA_VIDEO_FORMAT_RGBA),
+    SPA_FORMAT_VIDEO_size, SPA_POD_CHOICE_RANGE_Rectangle (&SPA_RECTANGLE (320, 240),
+                                                           &SPA_RECTANGLE (1, 1),
+                                                           &SPA_RECTANGLE (8192, 8192)),
+    SPA_FORMAT_VIDEO_framerate, SPA_POD_CHOICE_RANGE_Fraction (&SPA_FRACTION (0, 1),
+                                                               &SPA_FRACTION (0, 1),
+                                                               &SPA_FRACTION (1000, 1)));
+
+  pw_thread_loop_lock (thumbnailer->pw_loop);
+
+  capture->pw_stream =
+    pw_stream_new (thumbnailer->pw_core,
+                   "xdg-desktop-portal-gtk window thumbnail",
+                   pw_properties_new (PW_KEY_MEDIA_TYPE, "Video",
+                                      PW_KEY_MEDIA_CATEGORY, "Capture",
+                                      PW_KEY_MEDIA_ROLE, "Screen",
+                                      NULL));
+  if (capture->pw_stream)
+    {
+      pw_stream_add_listener (capture->pw_stream,
+                              &capture->stream_listener,
+                              &stream_events,
+                              capture);
+      if (pw_stream_connect (capture->pw_stream,
+                             PW_DIRECTION_INPUT,
+                             node_id,
+                             PW_STREAM_FLAG_AUTOCONNECT |
+                             PW_STREAM_FLAG_MAP_BUFFERS,
+                             params, 1) < 0)
+        {
+          spa_hook_remove (&capture->stream_listener);
+          pw_stream_destroy (capture->pw_stream);
+          capture->pw_stream = NULL;
+        }
+    }
+
+  pw_thread_loop_unlock (thumbnailer->pw_loop);
+
+  if (!capture->pw_stream)
+    {
+      g_debug ("Failed to connect to PipeWire node %u", node_id);
+      finish_capture (capture, NULL);
+    }
+}
+
+static void
+on_session_started (GObject *source_object,
+                    GAsyncResult *res,
+                    gpointer user_data)
+{
+  Capture *capture = user_data;
+  g_autoptr(GError) error = NULL;
+
+  if (!org_gnome_mutter_screen_cast_session_call_start_finish (ORG_GNOME_MUTTER_SCREEN_CAST_SESSION (source_object),
+                                                               res,
+                                                               &error))
+    {
+      fail_capture (capture, "Start", error);
+      return;
+    }
+}
+
+static void
+on_stream_proxy_created (GObject *source_object,
+                         GAsyncResult *res,
+                         gpointer user_data)
+{
+  Capture *capture = user_data;
+  OrgGnomeMutterScreenCastStream *stream_proxy;
+  g_autoptr(GError) error = NULL;
+
+  stream_proxy = org_gnome_mutter_screen_cast_stream_proxy_new_finish (res, &error);
+  if (!stream_proxy)
+    {
+      fail_capture (capture, "Stream", error);
+      return;
+    }
+
+  capture->stream_proxy = stream_proxy;
+  capture->stream_added_handler_id =
+    g_signal_connect (stream_proxy, "pipewire-stream-added",
+                      G_CALLBACK (on_pipewire_stream_added),
+                      capture);
+
+  org_gnome_mutter_screen_cast_session_call_start (capture->session_proxy,
+                                                   capture->cancellable,
+                                                   on_session_started,
+                                                   capture);
+}
+
+static void
+on_window_recorded (GObject *source_object,
+                    GAsyncResult *res,
+                    gpointer user_data)
+{
+  Capture *capture = user_data;
+  g_autofree char *stream_path = NULL;
+  g_autoptr(GError) error = NULL;
+
+  if (!org_gnome_mutter_screen_cast_session_call_record_window_finish (ORG_GNOME_MUTTER_SCREEN_CAST_SESSION (source_object),
+                                                                       &stream_path,
+                                                                       res,
+                                                                       &error))
+    {
+      fail_capture (capture, "RecordWindow", error);
+      return;
+    }
+
+  org_gnome_mutter_screen_cast_stream_proxy_new (g_dbus_proxy_get_connection (G_DBUS_PROXY (source_object)),
+                                                 G_DBUS_PROXY_FLAGS_DO_NOT_AUTO_START,
+                                                 "org.gnome.Mutter.ScreenCast",
+                                                 stream_path,
+                                                 capture->cancellable,
+                                                 on_stream_proxy_created,
+                                                 capture);
+}
+
+static void
+on_session_proxy_created (GObject *source_object,
+                          GAsyncResult *res,
+                          gpointer user_data)
+{
+  Capture *capture = user_data;
+  OrgGnomeMutterScreenCastSession *session_proxy;
+  GVariantBuilder properties_builder;
+  g_autoptr(GError) error = NULL;
+
+  session_proxy = org_gnome_mutter_screen_cast_session_proxy_new_finish (res, &error);
+  if (!session_proxy)
+    {
+      fail_capture (capture, "Session", error);
+      return;
+    }
+
+  capture->session_proxy = session_proxy;
+
+  g_variant_builder_init (&properties_builder, G_VARIANT_TYPE_VARDICT);
+  g_variant_builder_add (&properties_builder, "{sv}",
+                         "window-id",
+                         g_variant_new_uint64 (capture->window_id));
+  org_gnome_mutter_screen_cast_session_call_record_window (session_proxy,
+                                                           g_variant_builder_end (&properties_builder),
+                                                           capture->cancellable,
+                                                           on_window_recorded,
+                                                           capture);
+}
+
+static void
+on_session_created (GObject *source_object,
+                    GAsyncResult *res,
+                    gpointer user_data)
+{
+  Capture *capture = user_data;
+  g_autofree char *session_path = NULL;
+  g_autoptr(GError) error = NULL;
+
+  if (!org_gnome_mutter_screen_cast_call_create_session_finish (ORG_GNOME_MUTTER_SCREEN_CAST (source_object),
+                                                                &session_path,
+                                                                res,
+                                                                &error))
+    {
+      fail_capture (capture, "CreateSession", error);
+      return;
+    }
+
+  org_gnome_mutter_screen_cast_session_proxy_new (g_dbus_proxy_get_connection (G_DBUS_PROXY (source_object)),
+                                                  G_DBUS_PROXY_FLAGS_DO_NOT_AUTO_START,
+                                                  "org.gnome.Mutter.ScreenCast",
+                                                  session_path,
+                                                  capture->cancellable,
+                                                  on_session_proxy_created,
+                                                  capture);
+}
+
+static gboolean
+capture_timeout_cb (gpointer user_data)
+{
+  Capture *capture = user_data;
+
+  g_debug ("Timed out capturing window %" G_GUINT64_FORMAT,
+           capture->window_id);
+
+  capture->timeout_id = 0;
+  finish_capture (capture, NULL);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+start_capture (WindowThumbnailer *thumbnailer,
+               uint64_t window_id)
+{
+  Capture *capture;
+  GVariantBuilder properties_builder;
+
+  capture = g_new0 (Capture, 1);
+  capture->ref_count = 1;
+  capture->thumbnailer = thumbnailer;
+  capture->window_id = window_id;
+  capture->start_time = g_get_monotonic_time ();
+  capture->cancellable = g_cancellable_new ();
+  capture->timeout_id = g_timeout_add (CAPTURE_TIMEOUT_MS,
+                                       capture_timeout_cb,
+                                       capture);
+
+  thumbnailer->captures = g_list_prepend (thumbnailer->captures, capture);
+  thumbnailer->n_captures++;
+
+  g_variant_builder_init (&properties_builder, G_VARIANT_TYPE_VARDICT);
+  org_gnome_mutter_screen_cast_call_create_session (thumbnailer->proxy,
+                                                    g_variant_builder_end (&properties_builder),
+                                                    capture->cancellable,
+                                                    on_session_created,
+                                                    capture);
+}
+
+static gint64
+get_refresh_interval (WindowThumbnailer *thumbnailer)
+{
+  gint64 interval;
+
+  interval = thumbnailer->window_ids->len * thumbnailer->capture_cost /
+             CAPTURE_TIME_BUDGET;
+
+  return MAX (interval, MIN_REFRESH_INTERVAL_US);
+}
+
+static gboolean
+refresh_timeout_cb (gpointer user_data)
+{
+  WindowThumbnailer *thumbnailer = user_data;
+
+  thumbnailer->refresh_timeout_id = 0;
+  schedule_captures (thumbnailer);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+schedule_captures (WindowThumbnailer *thumbnailer)
+{
+  gint64 now = g_get_monotonic_time ();
+  gint64 next_due = G_MAXINT64;
+  gint64 interval;
+  guint i;
+
+  if (thumbnailer->refresh_timeout_id)
+    {
+      g_source_remove (thumbnailer->refresh_timeout_id);
+      thumbnailer->refresh_timeout_id = 0;
+    }
+
+  if (!thumbnailer->proxy || !thumbnailer->pw_core)
+    return;
+
+  interval = get_refresh_interval (thumbnailer);
+
+  for (i = 0; i < thumbnailer->window_ids->len; i++)
+    {
+      uint64_t window_id = g_array_index (thumbnailer->window_ids, uint64_t, i);
+      CaptureTime *capture_time;
+      gint64 due;
+
+      if (is_capturing (thumbnailer, window_id))
+        continue;
+
+      capture_time = g_hash_table_lookup (thumbnailer->capture_times,
+                                          &window_id);
+      due = capture_time ? capture_time->time + interval : now;
+
+      if (due <= now && thumbnailer->n_captures < MAX_CAPTURES)
+        start_capture (thumbnailer, window_id);
+      else
+        next_due = MIN (next_due, MAX (due, now));
+    }
+
+  /* Windows left waiting for a free capture slot are picked up when
+   * a capture finishes, the timeout is only for later refreshes.
+   */
+  if (next_due > now && next_due != G_MAXINT64)
+    thumbnailer->refresh_timeout_id =
+      g_timeout_add ((next_due - now) / 1000 + 1,
+                     refresh_timeout_cb,
+                     thumbnailer);
+}
+
+void
+window_thumbnailer_set_windows (WindowThumbnailer *thumbnailer,
+                                const uint64_t *window_ids,
+                                guint n_window_ids)
+{
+  g_autoptr(GHashTable) capture_times = NULL;
+  guint i;
+
+  n_window_ids = MIN (n_window_ids, MAX_WINDOWS);
+
+  /* Windows that are scrolled back into view get a fresh thumbnail. */
+  capture_times = g_steal_pointer (&thumbnailer->capture_times);
+  thumbnailer->capture_times = g_hash_table_new_full (g_int64_hash,
+                                                      g_int64_equal,
+                                                      NULL, g_free);
+
+  g_array_set_size (thumbnailer->window_ids, 0);
+  for (i = 0; i < n_window_ids; i++)
+    {
+      CaptureTime *capture_time;
+
+      g_array_append_val (thumbnailer->window_ids, window_ids[i]);
+
+      capture_time = g_hash_table_lookup (capture_times, &window_ids[i]);
+      if (capture_time && g_hash_table_steal (capture_times, &window_ids[i]))
+        g_hash_table_insert (thumbnailer->capture_times,
+                             &capture_time->window_id, capture_time);
+    }
+
+  schedule_captures (thumbnailer);
+}
+
+static void
+on_proxy_created (GObject *source_object,
+                  GAsyncResult *res,
+                  gpointer user_data)
+{
+  WindowThumbnailer *thumbnailer;
+  OrgGnomeMutterScreenCast *proxy;
+  g_autoptr(GError) error = NULL;
+
+  proxy = org_gnome_mutter_screen_cast_proxy_new_finish (res, &error);
+  if (!proxy)
+    {
+      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        g_debug ("No window thumbnails, failed to acquire "
+                 "org.gnome.Mutter.ScreenCast proxy: %s", error->message);
+      return;
+    }
+
+  thumbnailer = WINDOW_THUMBNAILER (user_data);
+
+  if (org_gnome_mutter_screen_cast_get_version (proxy) < 2)
+    {
+      g_debug ("No window thumbnails, org.gnome.Mutter.ScreenCast "
+               "can't record windows");
+      g_object_unref (proxy);
+      return;
+    }
+
+  thumbnailer->proxy = proxy;
+  schedule_captures (thumbnailer);
+}
+
+static void
+on_bus_get (GObject *source_object,
+            GAsyncResult *res,
+            gpointer user_data)
+{
+  g_autoptr(GDBusConnection) connection = NULL;
+  g_autoptr(GError) error = NULL;
+  WindowThumbnailer *thumbnailer;
+
+  connection = g_bus_get_finish (res, &error);
+  if (!connection)
+    {
+      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        g_debug ("No window thumbnails, no session bus: %s", error->message);
+      return;
+    }
+
+  thumbnailer = WINDOW_THUMBNAILER (user_data);
+  org_gnome_mutter_screen_cast_proxy_new (connection,
+                                          G_DBUS_PROXY_FLAGS_DO_NOT_AUTO_START,
+                                          "org.gnome.Mutter.ScreenCast",
+                                          "/org/gnome/Mutter/ScreenCast",
+                                          thumbnailer->cancellable,
+                                          on_proxy_created,
+                                          thumbnailer);
+}
+
+static gboolean
+init_pipewire (WindowThumbnailer *thumbnailer)
+{
+  pw_init (NULL, NULL);
+
+  thumbnailer->pw_loop = pw_thread_loop_new ("window-thumbnailer", NULL);
+  if (!thumbnailer->pw_loop)
+    return FALSE;
+
+  thumbnailer->pw_context =
+    pw_context_new (pw_thread_loop_get_loop (thumbnailer->pw_loop), NULL, 0);
+  if (!thumbnailer->pw_context)
+    return FALSE;
+
+  if (pw_thread_loop_start (thumbnailer->pw_loop) < 0)
+    return FALSE;
+
+  pw_thread_loop_lock (thumbnailer->pw_loop);
+  thumbnailer->pw_core = pw_context_connect (thumbnailer->pw_context, NULL, 0);
+  pw_thread_loop_unlock (thumbnailer->pw_loop);
+
+  return thumbnailer->pw_core != NULL;
+}
+
+static void
+window_thumbnailer_dispose (GObject *object)
+{
+  WindowThumbnailer *thumbnailer = WINDOW_THUMBNAILER (object);
+
+  g_cancellable_cancel (thumbnailer->cancellable);
+
+  g_array_set_size (thumbnailer->window_ids, 0);
+  while (thumbnailer->captures)
+    finish_capture (thumbnailer->captures->data, NULL);
+
+  if (thumbnailer->refresh_timeout_id)
+    {
+      g_source_remove (thumbnailer->refresh_timeout_id);
+      thumbnailer->refresh_timeout_id = 0;
+    }
+
+  if (thumbnailer->pw_loop)
+    pw_thread_loop_stop (thumbnailer->pw_loop);
+  if (thumbnailer->pw_core)
+    {
+      pw_core_disconnect (thumbnailer->pw_core);
+      thumbnailer->pw_core = NULL;
+    }
+  if (thumbnailer->pw_context)
+    {
+      pw_context_destroy (thumbnailer->pw_context);
+      thumbnailer->pw_context = NULL;
+    }
+  if (thumbnailer->pw_loop)
+    {
+      pw_thread_loop_destroy (thumbnailer->pw_loop);
+      thumbnailer->pw_loop = NULL;
+    }
+
+  g_clear_object (&thumbnailer->proxy);
+
+  G_OBJECT_CLASS (window_thumbnailer_parent_class)->dispose (object);
+}
+
+static void
+window_thumbnailer_finalize (GObject *object)
+{
+  WindowThumbnailer *thumbnailer = WINDOW_THUMBNAILER (object);
+
+  g_array_unref (thumbnailer->window_ids);
+  g_hash_table_unref (thumbnailer->capture_times);
+  g_object_unref (thumbnailer->cancellable);
+
+  G_OBJECT_CLASS (window_thumbnailer_parent_class)->finalize (object);
+}
+
+static void
+window_thumbnailer_init (WindowThumbnailer *thumbnailer)
+{
+  thumbnailer->cancellable = g_cancellable_new ();
+  thumbnailer->window_ids = g_array_new (FALSE, FALSE, sizeof (uint64_t));
+  thumbnailer->capture_times = g_hash_table_new_full (g_int64_hash,
+                                                      g_int64_equal,
+                                                      NULL, g_free);
+}
+
+static void
+window_thumbnailer_class_init (WindowThumbnailerClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->dispose = window_thumbnailer_dispose;
+  object_class->finalize = window_thumbnailer_finalize;
+
+  signals[THUMBNAIL_READY] = g_signal_new ("thumbnail-ready",
+                                           G_TYPE_FROM_CLASS (klass),
+                                           G_SIGNAL_RUN_LAST,
+                                           0,
+                                           NULL, NULL,
+                                           NULL,
+                                           G_TYPE_NONE, 2,
+                                           G_TYPE_UINT64,
+                                           GDK_TYPE_PIXBUF);
+}
+
+WindowThumbnailer *
+window_thumbnailer_new (void)
+{
+  WindowThumbnailer *thumbnailer;
+
+  thumbnailer = g_object_new (window_thumbnailer_get_type (), NULL);
+
+  if (!init_pipewire (thumbnailer))
+    {
+      g_debug ("No window thumbnails, failed to connect to PipeWire");
+      return thumbnailer;
+    }
+
+  g_bus_get (G_BUS_TYPE_SESSION,
+             thumbnailer->cancellable,
+             on_bus_get,
+             thumbnailer);
+
+  return thumbnailer;
+}
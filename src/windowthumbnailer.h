@@ -0,0 +1,35 @@
+/*
+ * Copyright © 2026 xdg-desktop-portal-gtk contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include <gdk-pixbuf/gdk-pixbuf.h>
+#include <glib-object.h>
+#include <stdint.h>
+
+#define WINDOW_THUMBNAIL_WIDTH 160
+#define WINDOW_THUMBNAIL_HEIGHT 100
+
+G_DECLARE_FINAL_TYPE (WindowThumbnailer, window_thumbnailer,
+                      WINDOW, THUMBNAILER, GObject)
+
+void window_thumbnailer_set_windows (WindowThumbnailer *thumbnailer,
+                                     const uint64_t *window_ids,
+                                     guint n_window_ids);
+
+WindowThumbnailer * window_thumbnailer_new (void);
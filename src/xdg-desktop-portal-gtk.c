@@ -41,6 +41,7 @@
 #include "xdg-desktop-portal-dbus.h"
 
 #include "request.h"
+#include "trace.h"
 #include "filechooser.h"
 #include "appchooser.h"
 #include "print.h"
@@ -98,96 +99,57 @@ printerr_handler (const gchar *string)
   fprintf (stderr, "%serror: %s%s\n", prefix, suffix, string);
 }
 
+static struct {
+  const char *name;
+  gboolean (* init) (GDBusConnection *bus,
+                     GError **error);
+} backends[] = {
+  { "file chooser", file_chooser_init },
+  { "app chooser", app_chooser_init },
+  { "print", print_init },
+  { "screenshot", screenshot_init },
+  { "notification", notification_init },
+  { "inhibit", inhibit_init },
+  { "access", access_init },
+  { "account", account_init },
+  { "email", email_init },
+  { "screencast", screen_cast_init },
+  { "remote desktop", remote_desktop_init },
+  { "lockdown", lockdown_init },
+  { "background", background_init },
+  { "settings", settings_init },
+};
+
 static void
 on_bus_acquired (GDBusConnection *connection,
                  const gchar     *name,
                  gpointer         user_data)
 {
   GError *error = NULL;
+  gint64 start_time;
+  gint64 duration;
+  gsize i;
 
-  if (!file_chooser_init (connection, &error))
-    {
-      g_warning ("error: %s\n", error->message);
-      g_clear_error (&error);
-    }
-
-  if (!app_chooser_init (connection, &error))
-    {
-      g_warning ("error: %s\n", error->message);
-      g_clear_error (&error);
-    }
-
-  if (!print_init (connection, &error))
-    {
-      g_warning ("error: %s\n", error->message);
-      g_clear_error (&error);
-    }
-
-  if (!screenshot_init (connection, &error))
-    {
-      g_warning ("error: %s\n", error->message);
-      g_clear_error (&error);
-    }
-
-  if (!notification_init (connection, &error))
-    {
-      g_warning ("error: %s\n", error->message);
-      g_clear_error (&error);
-    }
-
-  if (!inhibit_init (connection, &error))
-    {
-      g_warning ("error: %s\n", error->message);
-      g_clear_error (&error);
-    }
-
-  if (!access_init (connection, &error))
-    {
-      g_warning ("error: %s\n", error->message);
-      g_clear_error (&error);
-    }
-
-  if (!account_init (connection, &error))
-    {
-      g_warning ("error: %s\n", error->message);
-      g_clear_error (&error);
-    }
+  start_time = TRACE_CURRENT_TIME;
 
-  if (!email_init (connection, &error))
+  for (i = 0; i < G_N_ELEMENTS (backends); i++)
     {
-      g_warning ("error: %s\n", error->message);
-      g_clear_error (&error);
-    }
+      gint64 backend_start_time = TRACE_CURRENT_TIME;
 
-  if (!screen_cast_init (connection, &error))
-    {
-      g_warning ("error: %s\n", error->message);
-      g_clear_error (&error);
-    }
+      if (!backends[i].init (connection, &error))
+        {
+          g_warning ("error: %s\n", error->message);
+          g_clear_error (&error);
+        }
 
-  if (!remote_desktop_init (connection, &error))
-    {
-      g_warning ("error: %s\n", error->message);
-      g_clear_error (&error);
+      duration = TRACE_CURRENT_TIME - backend_start_time;
+      trace_mark (backend_start_time, duration, "backend-init", "%s", backends[i].name);
+      g_debug ("%s backend initialized in %.3f ms", backends[i].name, duration / 1000000.0);
     }
 
-  if (!lockdown_init (connection, &error))
-    {
-      g_warning ("error: %s\n", error->message);
-      g_clear_error (&error);
-    }
-
-  if (!background_init (connection, &error))
-    {
-      g_warning ("error: %s\n", error->message);
-      g_clear_error (&error);
-    }
-
-  if (!settings_init (connection, &error))
-    {
-      g_warning ("error: %s\n", error->message);
-      g_clear_error (&error);
-    }
+  duration = TRACE_CURRENT_TIME - start_time;
+  trace_mark (start_time, duration, "init", "All backends");
+  g_debug ("All backends initialized in %.3f ms", duration / 1000000.0);
 }
 
 static void
@@ -259,6 +221,8 @@ main (int argc, char *argv[])
 
   g_set_prgname ("xdg-desktop-portal-gtk");
 
+  trace_init ();
+
   loop = g_main_loop_new (NULL, FALSE);
 
   outstanding_handles = g_hash_table_new (g_str_hash, g_str_equal);